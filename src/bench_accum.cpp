@@ -0,0 +1,85 @@
+// Many-writer accumulation benchmark: every thread adds its own matrices
+// into one shared sum, through S21Accumulator and through a mutex around
+// SumMatrix, reporting additions per second for a growing number of
+// writers and the difference of the two sums.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "s21_matrix_accum.h"
+
+namespace {
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+S21Matrix Random(const int rows, const int cols, unsigned state) {
+  S21Matrix m(rows, cols);
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      state = state * 1664525u + 1013904223u;
+      m(i, j) = (state >> 8) / 16777216.0 - 0.5;
+    }
+  }
+  return m;
+}
+
+// runs add(m) adds times on each of writers threads, in seconds
+template <class F>
+double Run(const int writers, const int adds, const S21Matrix& m, F&& add) {
+  std::vector<std::thread> threads;
+  const auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < writers; ++t) {
+    threads.emplace_back([&] {
+      for (int k = 0; k < adds; ++k) add(m);
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  return Seconds(start);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int n = argc > 1 ? std::atoi(argv[1]) : 256;
+  const int adds = argc > 2 ? std::atoi(argv[2]) : 200;
+  const int max_writers = std::max(
+      1, argc > 3 ? std::atoi(argv[3])
+                  : static_cast<int>(std::thread::hardware_concurrency()));
+  const S21Matrix m = Random(n, n, 1);
+  std::printf("%d x %d, %d adds per writer, %u hardware threads\n", n, n,
+              adds, std::thread::hardware_concurrency());
+  std::printf("%8s %14s %14s %10s\n", "writers", "sharded add/s",
+              "mutex add/s", "max diff");
+  for (int writers = 1; writers <= max_writers; writers *= 2) {
+    S21Accumulator acc(n, n);
+    const double sharded =
+        Run(writers, adds, m, [&](const S21Matrix& x) { acc += x; });
+    S21Matrix locked(n, n);
+    std::mutex mu;
+    const double mutex = Run(writers, adds, m, [&](const S21Matrix& x) {
+      std::lock_guard<std::mutex> lock(mu);
+      locked.SumMatrix(x);
+    });
+    const S21Matrix sum = acc.Collect();
+    double diff = 0;
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        diff = std::max(diff, std::fabs(sum(i, j) - locked(i, j)));
+      }
+    }
+    const double total = double(writers) * adds;
+    std::printf("%8d %14.0f %14.0f %10.2e\n", writers, total / sharded,
+                total / mutex, diff);
+  }
+  return 0;
+}
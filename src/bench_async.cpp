@@ -0,0 +1,122 @@
+// Task graph benchmark: a single product and a tree of independent products
+// summed pairwise, run through S21TaskGraph and as plain synchronous calls.
+// Reports the synchronous time of every operation added up (the serial sum)
+// against the wall time of the graph, best of a few repetitions.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "s21_matrix_async.h"
+
+namespace {
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+S21Matrix Random(const int rows, const int cols, unsigned state) {
+  S21Matrix m(rows, cols);
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      state = state * 1664525u + 1013904223u;
+      m(i, j) = (state >> 8) / 16777216.0 - 0.5;
+    }
+  }
+  return m;
+}
+
+double MaxDiff(const S21Matrix& a, const S21Matrix& b) {
+  double diff = 0;
+  for (int i = 0; i < a.get_Row(); ++i) {
+    for (int j = 0; j < a.get_Col(); ++j) {
+      diff = std::max(diff, std::fabs(a(i, j) - b(i, j)));
+    }
+  }
+  return diff;
+}
+
+// sum of a[i] * b[i], every operation timed on its own
+S21Matrix Serial(const std::vector<S21Matrix>& a,
+                 const std::vector<S21Matrix>& b, double* seconds) {
+  *seconds = 0;
+  std::vector<S21Matrix> level;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    S21Matrix p(1, 1);
+    const auto start = std::chrono::steady_clock::now();
+    S21Matrix::MulInto(a[i], b[i], p);
+    *seconds += Seconds(start);
+    level.push_back(std::move(p));
+  }
+  while (level.size() > 1) {
+    std::vector<S21Matrix> next;
+    for (std::size_t i = 0; i + 1 < level.size(); i += 2) {
+      const auto start = std::chrono::steady_clock::now();
+      level[i].SumMatrix(level[i + 1]);
+      *seconds += Seconds(start);
+      next.push_back(std::move(level[i]));
+    }
+    if (level.size() % 2) next.push_back(std::move(level.back()));
+    level = std::move(next);
+  }
+  return level[0];
+}
+
+S21Matrix Graph(const std::vector<S21Matrix>& a,
+                const std::vector<S21Matrix>& b, double* seconds) {
+  S21TaskGraph graph;
+  std::vector<S21AsyncMatrix> level;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    level.push_back(graph.Input(a[i]).MulMatrixAsync(graph.Input(b[i])));
+  }
+  while (level.size() > 1) {
+    std::vector<S21AsyncMatrix> next;
+    for (std::size_t i = 0; i + 1 < level.size(); i += 2) {
+      next.push_back(level[i].SumMatrixAsync(level[i + 1]));
+    }
+    if (level.size() % 2) next.push_back(level.back());
+    level = std::move(next);
+  }
+  // recording only copies the inputs; the operations run from here
+  const auto start = std::chrono::steady_clock::now();
+  S21Matrix res = level[0].get();
+  *seconds = Seconds(start);
+  return res;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int n = argc > 1 ? std::atoi(argv[1]) : 384;
+  const int max_branches = argc > 2 ? std::atoi(argv[2]) : 8;
+  const int reps = argc > 3 ? std::max(1, std::atoi(argv[3])) : 3;
+  std::printf("%d x %d products, best of %d, %u hardware threads\n", n, n,
+              reps, std::thread::hardware_concurrency());
+  std::printf("%9s %12s %12s %9s %10s\n", "products", "serial sum s",
+              "graph s", "speedup", "max diff");
+  for (int branches = 1; branches <= max_branches; branches *= 2) {
+    std::vector<S21Matrix> a, b;
+    for (int i = 0; i < branches; ++i) {
+      a.push_back(Random(n, n, 2 * i + 1));
+      b.push_back(Random(n, n, 2 * i + 2));
+    }
+    double serial = 1e300, graph = 1e300, diff = 0;
+    for (int r = 0; r < reps; ++r) {
+      double s = 0, g = 0;
+      const S21Matrix expected = Serial(a, b, &s);
+      const S21Matrix res = Graph(a, b, &g);
+      serial = std::min(serial, s);
+      graph = std::min(graph, g);
+      diff = std::max(diff, MaxDiff(expected, res));
+    }
+    std::printf("%9d %12.4f %12.4f %9.2f %10.2e\n", branches, serial, graph,
+                serial / graph, diff);
+  }
+  return 0;
+}
@@ -0,0 +1,98 @@
+// Text I/O benchmark: throughput of S21MatrixIO for CSV and Matrix Market,
+// in memory and through files, against a plain iostream >> loop.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "s21_matrix_io.h"
+#include "s21_parallel.h"
+
+namespace {
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+void Report(const char* name, const double bytes, const double seconds) {
+  std::printf("%-22s %9.3f ms  %6.2f GB/s\n", name, seconds * 1e3,
+              bytes / seconds / 1e9);
+}
+
+S21Matrix Random(const int rows, const int cols) {
+  S21Matrix m(rows, cols);
+  unsigned state = 12345;
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      state = state * 1664525u + 1013904223u;
+      m(i, j) = (state >> 8) / 16777216.0 - 0.5;
+    }
+  }
+  return m;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int n = argc > 1 ? std::atoi(argv[1]) : 2048;
+  const std::string dir = argc > 2 ? argv[2] : ".";
+  const std::string csv = dir + "/bench_io.csv";
+  const std::string mtx = dir + "/bench_io.mtx";
+  std::printf("workers=%d matrix=%dx%d\n", S21ThreadPool::Instance().Workers(),
+              n, n);
+  const S21Matrix m = Random(n, n);
+
+  auto start = std::chrono::steady_clock::now();
+  const std::string text = S21MatrixIO::FormatCsv(m);
+  const double bytes = text.size();
+  Report("FormatCsv", bytes, Seconds(start));
+  std::printf("  csv text %.1f MiB\n", bytes / (1 << 20));
+
+  start = std::chrono::steady_clock::now();
+  S21Matrix back = S21MatrixIO::ParseCsv(text);
+  Report("ParseCsv", bytes, Seconds(start));
+  if (!back.EqMatrix(m, S21Tolerance{0})) {
+    std::printf("round trip mismatch\n");
+    return 1;
+  }
+
+  start = std::chrono::steady_clock::now();
+  S21MatrixIO::ToCsv(m, csv);
+  Report("ToCsv (file)", bytes, Seconds(start));
+
+  start = std::chrono::steady_clock::now();
+  back = S21MatrixIO::FromCsv(csv);
+  Report("FromCsv (file)", bytes, Seconds(start));
+
+  // the baseline every loader used to be: one operator>> per element
+  start = std::chrono::steady_clock::now();
+  {
+    std::ifstream in(csv);
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < n; ++j) {
+        in >> back(i, j);
+        in.ignore(1);
+      }
+    }
+  }
+  Report("iostream >> (file)", bytes, Seconds(start));
+
+  start = std::chrono::steady_clock::now();
+  S21MatrixIO::ToMatrixMarket(m, mtx);
+  const double seconds = Seconds(start);
+  std::ifstream size(mtx, std::ios::binary | std::ios::ate);
+  const double mtx_bytes = size.tellg();
+  Report("ToMatrixMarket (file)", mtx_bytes, seconds);
+
+  start = std::chrono::steady_clock::now();
+  back = S21MatrixIO::FromMatrixMarket(mtx);
+  Report("FromMatrixMarket", mtx_bytes, Seconds(start));
+
+  std::remove(csv.c_str());
+  std::remove(mtx.c_str());
+  return 0;
+}
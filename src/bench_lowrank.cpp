@@ -0,0 +1,130 @@
+// Low-rank benchmark: accuracy against time of the randomized SVD and ID
+// for both sketches and a few power iteration counts, against the exact
+// Jacobi SVD, on a synthetic matrix of known rank with decaying noise.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "s21_matrix_lowrank.h"
+#include "s21_parallel.h"
+
+namespace {
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+double FrobeniusError(const S21Matrix& a, const S21Matrix& b) {
+  double diff = 0, norm = 0;
+  for (int i = 0; i < a.get_Row(); ++i) {
+    const double* x = a.data(i);
+    const double* y = b.data(i);
+    for (int j = 0; j < a.get_Col(); ++j) {
+      diff += (x[j] - y[j]) * (x[j] - y[j]);
+      norm += x[j] * x[j];
+    }
+  }
+  return std::sqrt(diff / norm);
+}
+
+// m x n with singular values 1, 0.9, 0.81, ... for the first rank ones and
+// a slowly decaying tail noise * 0.9^rank * 0.97^(i - rank) after them
+S21Matrix Synthetic(const int m, const int n, const int rank,
+                    const double noise) {
+  const int k = std::min(m, n);
+  S21LowRankOptions options;
+  options.rank = k;
+  options.oversampling = 0;
+  options.power_iterations = 0;
+  // random orthonormal bases from the range finder of random matrices
+  S21Matrix g1(m, k), g2(n, k);
+  unsigned state = 99;
+  for (S21Matrix* g : {&g1, &g2}) {
+    for (int i = 0; i < g->get_Row(); ++i) {
+      for (int j = 0; j < k; ++j) {
+        state = state * 1664525u + 1013904223u;
+        (*g)(i, j) = (state >> 8) / 16777216.0 - 0.5;
+      }
+    }
+  }
+  S21Matrix u = S21LowRank::RangeFinder(g1, options);
+  S21Matrix v = S21LowRank::RangeFinder(g2, options);
+  double sigma = 1;
+  for (int j = 0; j < k; ++j) {
+    for (int i = 0; i < m; ++i) u(i, j) *= sigma;
+    sigma *= j + 1 < rank ? 0.9 : (j + 1 == rank ? noise : 0.97);
+  }
+  return u * v.Transpose();
+}
+
+// best rank-k approximation out of a full SVD
+S21LowRank::Svd Truncate(const S21LowRank::Svd& svd, const int k) {
+  const int m = svd.u.get_Row();
+  const int n = svd.vt.get_Col();
+  S21LowRank::Svd res{S21Matrix(m, k), svd.s, S21Matrix(k, n)};
+  res.s.resize(k);
+  for (int i = 0; i < m; ++i) {
+    for (int j = 0; j < k; ++j) res.u(i, j) = svd.u(i, j);
+  }
+  for (int i = 0; i < k; ++i) {
+    for (int j = 0; j < n; ++j) res.vt(i, j) = svd.vt(i, j);
+  }
+  return res;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int m = argc > 1 ? std::atoi(argv[1]) : 600;
+  const int n = argc > 2 ? std::atoi(argv[2]) : 500;
+  const int rank = argc > 3 ? std::atoi(argv[3]) : 20;
+  // the exact SVD is skipped above this size, it grows as min(m, n)^2 * n
+  const int exact_limit = argc > 4 ? std::atoi(argv[4]) : 600;
+  std::printf("workers=%d matrix=%dx%d rank=%d\n",
+              S21ThreadPool::Instance().Workers(), m, n, rank);
+  const S21Matrix a = Synthetic(m, n, rank, 1e-3);
+
+  if (std::min(m, n) <= exact_limit) {
+    const auto start = std::chrono::steady_clock::now();
+    const S21LowRank::Svd svd = S21LowRank::ExactSvd(a);
+    const double seconds = Seconds(start);
+    std::printf("%-28s %9.3f ms  rel. error %.3e (optimal for rank %d)\n",
+                "exact jacobi svd", seconds * 1e3,
+                FrobeniusError(a, S21LowRank::Reconstruct(Truncate(svd, rank))),
+                rank);
+  }
+
+  const struct {
+    const char* name;
+    S21Sketch::Kind kind;
+  } sketches[] = {{"gaussian", S21Sketch::Kind::kGaussian},
+                  {"srht", S21Sketch::Kind::kSrht}};
+  for (const auto& sketch : sketches) {
+    for (int q = 0; q <= 2; ++q) {
+      S21LowRankOptions options;
+      options.rank = rank;
+      options.power_iterations = q;
+      options.sketch = sketch.kind;
+      auto start = std::chrono::steady_clock::now();
+      const S21LowRank::Svd svd = S21LowRank::RandomizedSvd(a, options);
+      double seconds = Seconds(start);
+      char name[64];
+      std::snprintf(name, sizeof(name), "rsvd %s q=%d", sketch.name, q);
+      std::printf("%-28s %9.3f ms  rel. error %.3e\n", name, seconds * 1e3,
+                  FrobeniusError(a, S21LowRank::Reconstruct(svd)));
+
+      start = std::chrono::steady_clock::now();
+      const S21LowRank::Id id =
+          S21LowRank::InterpolativeDecomposition(a, options);
+      seconds = Seconds(start);
+      std::snprintf(name, sizeof(name), "id %s q=%d", sketch.name, q);
+      std::printf("%-28s %9.3f ms  rel. error %.3e\n", name, seconds * 1e3,
+                  FrobeniusError(a, S21LowRank::Reconstruct(a, id)));
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,95 @@
+// NUMA placement benchmark: times first touch and a few streaming kernels
+// for every S21Matrix::Placement. With libnuma (-DS21_HAVE_LIBNUMA) it also
+// reports on which nodes the pages of each matrix ended up.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "s21_matrix_oop.h"
+#include "s21_parallel.h"
+
+#ifdef S21_HAVE_LIBNUMA
+#include <numa.h>
+#include <numaif.h>
+#endif
+
+namespace {
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+void PrintPageNodes(S21Matrix& m) {
+#ifdef S21_HAVE_LIBNUMA
+  if (numa_available() < 0) {
+    std::printf("    page nodes: libnuma unavailable\n");
+    return;
+  }
+  const long page = numa_pagesize();
+  std::vector<void*> pages;
+  for (int i = 0; i < m.get_Row(); ++i) {
+    char* lo = reinterpret_cast<char*>(m.data(i));
+    char* hi = lo + m.get_Col() * sizeof(double);
+    for (char* p = lo; p < hi; p += page) pages.push_back(p);
+  }
+  std::vector<int> status(pages.size(), -1);
+  numa_move_pages(0, pages.size(), pages.data(), nullptr, status.data(), 0);
+  std::vector<long> per_node(numa_max_node() + 1, 0);
+  for (int s : status) {
+    if (s >= 0 && s < static_cast<int>(per_node.size())) ++per_node[s];
+  }
+  std::printf("    page nodes:");
+  for (std::size_t n = 0; n < per_node.size(); ++n) {
+    std::printf(" node%zu=%.1f%%", n, 100.0 * per_node[n] / pages.size());
+  }
+  std::printf("\n");
+#else
+  (void)m;
+  std::printf("    page nodes: built without libnuma\n");
+#endif
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int n = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const int reps = argc > 2 ? std::atoi(argv[2]) : 10;
+  const S21Topology& topo = S21Topology::Get();
+  std::printf("nodes=%d cpus=%d workers=%d matrix=%dx%d (%.1f MiB)\n",
+              topo.Nodes(), topo.Cpus(), S21ThreadPool::Instance().Workers(),
+              n, n, double(n) * n * sizeof(double) / (1 << 20));
+  if (topo.Nodes() < 2) {
+    std::printf("single NUMA node: placements only differ in who touches\n");
+  }
+
+  const struct {
+    const char* name;
+    S21Matrix::Placement placement;
+  } placements[] = {{"local", S21Matrix::Placement::kLocal},
+                    {"partitioned", S21Matrix::Placement::kPartitioned},
+                    {"interleave", S21Matrix::Placement::kInterleave}};
+
+  for (const auto& p : placements) {
+    auto start = std::chrono::steady_clock::now();
+    S21Matrix a(n, n, p.placement);
+    S21Matrix b(n, n, p.placement);
+    const double touch = Seconds(start) / 2;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; ++r) {
+      a.SumMatrix(b);
+      a.MulNumber(0.5);
+    }
+    const double stream = Seconds(start);
+    const double bytes = 5.0 * n * n * sizeof(double) * reps;
+
+    std::printf("%-12s first touch %8.3f ms  sum+scale %8.3f ms  %6.2f GB/s\n",
+                p.name, touch * 1e3, stream * 1e3 / reps, bytes / stream / 1e9);
+    PrintPageNodes(a);
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Reduced-precision benchmark: an activations x weights product with the
+// weights in double, IEEE half, bfloat16 and per-row int8, reporting time,
+// weight bandwidth, resident size and the observed error against the
+// reported bound. Few activation rows make the product bandwidth-bound.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "s21_matrix_quant.h"
+#include "s21_parallel.h"
+
+namespace {
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+S21Matrix Random(const int rows, const int cols, unsigned state) {
+  S21Matrix m(rows, cols);
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      state = state * 1664525u + 1013904223u;
+      m(i, j) = (state >> 8) / 16777216.0 - 0.5;
+    }
+  }
+  return m;
+}
+
+double MaxDiff(const S21Matrix& a, const S21Matrix& b) {
+  double diff = 0;
+  for (int i = 0; i < a.get_Row(); ++i) {
+    for (int j = 0; j < a.get_Col(); ++j) {
+      diff = std::max(diff, std::fabs(a(i, j) - b(i, j)));
+    }
+  }
+  return diff;
+}
+
+// best of a few runs, in seconds
+template <class F>
+double Best(F&& fn) {
+  double best = 1e30;
+  for (int run = 0; run < 5; ++run) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, Seconds(start));
+  }
+  return best;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int m = argc > 1 ? std::atoi(argv[1]) : 8;
+  const int k = argc > 2 ? std::atoi(argv[2]) : 4096;
+  const int n = argc > 3 ? std::atoi(argv[3]) : 4096;
+  std::printf("workers=%d activations %dx%d, weights %dx%d\n",
+              S21ThreadPool::Instance().Workers(), m, k, k, n);
+  const S21Matrix a = Random(m, k, 1);
+  const S21Matrix w = Random(k, n, 2);
+  S21Matrix exact(m, n);
+  S21Matrix out(m, n);
+
+  const double dense_bytes = double(k) * n * sizeof(double);
+  double seconds = Best([&] { S21Matrix::MulInto(a, w, exact); });
+  std::printf("%-10s %9.3f ms %7.2f GB/s  %8.1f MiB\n", "double",
+              seconds * 1e3, dense_bytes / seconds * 1e-9,
+              dense_bytes / (1 << 20));
+
+  const struct {
+    const char* name;
+    S21QuantizedMatrix::Format format;
+  } formats[] = {{"half", S21QuantizedMatrix::Format::kHalf},
+                 {"bfloat16", S21QuantizedMatrix::Format::kBfloat16},
+                 {"int8", S21QuantizedMatrix::Format::kInt8}};
+  for (const auto& f : formats) {
+    const S21QuantizedMatrix q(w, f.format);
+    const double bytes = q.Bytes();
+    seconds = Best([&] { S21QuantizedMatrix::MulInto(a, q, out); });
+    std::printf(
+        "%-10s %9.3f ms %7.2f GB/s  %8.1f MiB (%.1fx smaller)  "
+        "max error %.3e, bound %.3e\n",
+        f.name, seconds * 1e3, bytes / seconds * 1e-9, bytes / (1 << 20),
+        dense_bytes / bytes, MaxDiff(out, exact),
+        S21QuantizedMatrix::ErrorBound(a, q));
+  }
+  return 0;
+}
@@ -0,0 +1,149 @@
+// Layout benchmark: transpose and multiply on row-major S21Matrix against
+// S21TiledMatrix in block-major and Morton order, with cache and dTLB
+// misses from perf_event_open where the kernel allows it
+// (kernel.perf_event_paranoid <= 2).
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "s21_matrix_oop.h"
+#include "s21_matrix_tiled.h"
+#include "s21_parallel.h"
+
+namespace {
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Hardware counter of this process and its threads, -1 when unavailable.
+class Counter {
+ public:
+  Counter(const std::uint32_t type, const std::uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;  // count the pool workers too
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+  ~Counter() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  void Start() {
+    if (fd_ < 0) return;
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  long Stop() {
+    if (fd_ < 0) return -1;
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    long long count = 0;
+    if (read(fd_, &count, sizeof(count)) != sizeof(count)) return -1;
+    return static_cast<long>(count);
+  }
+
+ private:
+  int fd_;
+};
+
+Counter cache_misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+Counter tlb_misses(PERF_TYPE_HW_CACHE,
+                   PERF_COUNT_HW_CACHE_DTLB |
+                       (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+
+template <class F>
+void Measure(const char* name, F&& fn) {
+  cache_misses.Start();
+  tlb_misses.Start();
+  const auto start = std::chrono::steady_clock::now();
+  fn();
+  const double seconds = Seconds(start);
+  const long cache = cache_misses.Stop();
+  const long tlb = tlb_misses.Stop();
+  std::printf("%-24s %9.3f ms", name, seconds * 1e3);
+  if (cache >= 0) {
+    std::printf("  cache misses %12ld", cache);
+  } else {
+    std::printf("  cache misses          n/a");
+  }
+  if (tlb >= 0) {
+    std::printf("  dTLB misses %12ld\n", tlb);
+  } else {
+    std::printf("  dTLB misses          n/a\n");
+  }
+}
+
+S21Matrix Random(const int n) {
+  S21Matrix m(n, n);
+  unsigned state = 4321;
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      state = state * 1664525u + 1013904223u;
+      m(i, j) = (state >> 8) / 16777216.0 - 0.5;
+    }
+  }
+  return m;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // 4096^2 doubles are 128 MiB, well beyond any last level cache
+  const int n = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const int mul_n = argc > 2 ? std::atoi(argv[2]) : 1024;
+  std::printf("workers=%d transpose %dx%d, multiply %dx%d, tile %d\n",
+              S21ThreadPool::Instance().Workers(), n, n, mul_n, mul_n,
+              S21TiledMatrix::kDefaultTile);
+
+  const struct {
+    const char* name;
+    S21TiledMatrix::Order order;
+  } orders[] = {{"block-major", S21TiledMatrix::Order::kBlockMajor},
+                {"morton", S21TiledMatrix::Order::kMorton}};
+
+  {
+    S21Matrix m = Random(n);
+    S21Matrix out(n, n);
+    Measure("transpose row-major", [&] { m.TransposeInto(out); });
+    for (const auto& o : orders) {
+      S21TiledMatrix t(m, o.order);
+      char name[64];
+      std::snprintf(name, sizeof(name), "transpose %s", o.name);
+      Measure(name, [&] { t = t.Transpose(); });
+      std::snprintf(name, sizeof(name), "to tiled %s", o.name);
+      Measure(name, [&] { t = S21TiledMatrix(m, o.order); });
+    }
+  }
+
+  S21Matrix a = Random(mul_n);
+  S21Matrix b = a.Transpose();
+  S21Matrix c(mul_n, mul_n);
+  Measure("multiply row-major", [&] { S21Matrix::MulInto(a, b, c); });
+  for (const auto& o : orders) {
+    S21TiledMatrix ta(a, o.order);
+    S21TiledMatrix tb(b, o.order);
+    char name[64];
+    std::snprintf(name, sizeof(name), "multiply %s", o.name);
+    Measure(name, [&] { ta.MulMatrix(tb); });
+  }
+  return 0;
+}
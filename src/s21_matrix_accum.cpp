@@ -0,0 +1,172 @@
+#include "s21_matrix_accum.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "s21_parallel.h"
+
+namespace {
+
+// Threads are numbered in the order they first add, so consecutive threads
+// get consecutive home shards.
+std::atomic<int> next_thread{0};
+thread_local const int thread_number = next_thread.fetch_add(1);
+
+// dst[j] (+)= src[j] for j < n in fixed groups of eight, which the -O2
+// vectorizer takes whole
+template <bool kCopy>
+void Merge(double* __restrict dst, const double* __restrict src,
+           const int n) noexcept {
+  int j = 0;
+  for (; j + 8 <= n; j += 8) {
+    for (int u = 0; u < 8; ++u) {
+      dst[j + u] = (kCopy ? 0 : dst[j + u]) + src[j + u];
+    }
+  }
+  for (; j < n; ++j) dst[j] = (kCopy ? 0 : dst[j]) + src[j];
+}
+
+}  // namespace
+
+S21Accumulator::S21Accumulator(int rows, int cols, int shards)
+    : rows_(rows), cols_(cols), shards_(shards) {
+  if (rows < 1 || cols < 1 || shards < 0) {
+    throw std::invalid_argument("Invalid argument");
+  }
+  if (shards_ == 0) {
+    shards_ =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  shard_.reset(new Shard[shards_]);
+}
+
+S21Accumulator::Shard& S21Accumulator::Claim() noexcept {
+  const int home = thread_number % shards_;
+  for (int i = home;;) {
+    Shard& s = shard_[i];
+    // test before exchange, so busy shards are only read, not bounced
+    if (!s.busy.load(std::memory_order_relaxed) &&
+        !s.busy.exchange(true, std::memory_order_acquire)) {
+      return s;
+    }
+    i = i + 1 == shards_ ? 0 : i + 1;
+    if (i == home) std::this_thread::yield();  // more writers than shards
+  }
+}
+
+void S21Accumulator::Add(const S21Matrix& m) {
+  if (m.get_Row() != rows_ || m.get_Col() != cols_) {
+    throw std::invalid_argument("Add: the matrices are different sizes");
+  }
+  Shard& s = Claim();
+  if (!s.used) {
+    if (s.sum.get_Row() != rows_ || s.sum.get_Col() != cols_) {
+      try {
+        // touched by this thread, so the pages land on its node
+        s.sum = S21Matrix(rows_, cols_, S21Matrix::Placement::kLocal);
+      } catch (...) {
+        s.busy.store(false, std::memory_order_release);
+        throw;
+      }
+    }
+    for (int i = 0; i < rows_; ++i) {
+      Merge<true>(s.sum.data(i), m.data(i), cols_);
+    }
+    s.used = true;
+  } else {
+    for (int i = 0; i < rows_; ++i) {
+      Merge<false>(s.sum.data(i), m.data(i), cols_);
+    }
+  }
+  s.busy.store(false, std::memory_order_release);
+}
+
+S21Accumulator& S21Accumulator::operator+=(const S21Matrix& m) {
+  Add(m);
+  return *this;
+}
+
+void S21Accumulator::LockAll() noexcept {
+  // in index order; Add holds at most one shard, so this cannot deadlock
+  for (int i = 0; i < shards_; ++i) {
+    while (shard_[i].busy.exchange(true, std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void S21Accumulator::UnlockAll() noexcept {
+  for (int i = 0; i < shards_; ++i) {
+    shard_[i].busy.store(false, std::memory_order_release);
+  }
+}
+
+// Level s of the tree merges shard i + s into shard i for every i that is a
+// multiple of 2s, so shard 0 ends up with the total after log2(shards)
+// levels. All levels run row by row: a row of every shard is merged while
+// it is in cache, and workers take disjoint row ranges.
+S21Matrix S21Accumulator::Collect() {
+  LockAll();
+  try {
+    struct Step {
+      int dst, src;
+      bool copy;  // dst holds nothing yet
+    };
+    std::vector<Step> steps;
+    std::vector<char> used(shards_);
+    for (int i = 0; i < shards_; ++i) used[i] = shard_[i].used;
+    for (int s = 1; s < shards_; s *= 2) {
+      for (int i = 0; i + s < shards_; i += 2 * s) {
+        if (!used[i + s]) continue;
+        steps.push_back({i, i + s, !used[i]});
+        used[i] = true;
+      }
+    }
+    if (!used[0]) {
+      UnlockAll();
+      return S21Matrix(rows_, cols_);
+    }
+    for (const Step& step : steps) {
+      S21Matrix& dst = shard_[step.dst].sum;
+      if (step.copy && (dst.get_Row() != rows_ || dst.get_Col() != cols_)) {
+        dst = S21Matrix(rows_, cols_);
+      }
+    }
+    S21ThreadPool::Instance().ParallelFor(
+        0, rows_, long(cols_) * steps.size(), [&](int lo, int hi) {
+          for (int r = lo; r < hi; ++r) {
+            for (const Step& step : steps) {
+              double* dst = shard_[step.dst].sum.data(r);
+              const double* src = shard_[step.src].sum.data(r);
+              if (step.copy) {
+                Merge<true>(dst, src, cols_);
+              } else {
+                Merge<false>(dst, src, cols_);
+              }
+            }
+          }
+        });
+    shard_[0].used = true;
+    for (int i = 1; i < shards_; ++i) shard_[i].used = false;
+    S21Matrix res(shard_[0].sum);
+    UnlockAll();
+    return res;
+  } catch (...) {
+    UnlockAll();
+    throw;
+  }
+}
+
+void S21Accumulator::Reset() {
+  LockAll();
+  for (int i = 0; i < shards_; ++i) shard_[i].used = false;
+  UnlockAll();
+}
+
+int S21Accumulator::get_Row() const { return rows_; }
+
+int S21Accumulator::get_Col() const { return cols_; }
+
+int S21Accumulator::Shards() const { return shards_; }
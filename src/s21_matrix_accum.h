@@ -0,0 +1,49 @@
+#ifndef __S21_MATRIX_ACCUM_H__
+#define __S21_MATRIX_ACCUM_H__
+
+#include <atomic>
+#include <memory>
+
+#include "s21_matrix_oop.h"
+
+// Sum of matrices added concurrently by many threads. Every thread has a
+// home shard, a private partial sum it claims with a single atomic
+// exchange; a thread that finds its home busy takes the next free shard,
+// so writers never wait on each other while shards outnumber them. Collect
+// merges the shards by a pairwise tree reduction, parallel over rows.
+class S21Accumulator {
+ public:
+  // shards = 0 takes one per hardware thread
+  S21Accumulator(int rows, int cols, int shards = 0);
+  S21Accumulator(const S21Accumulator&) = delete;
+  S21Accumulator& operator=(const S21Accumulator&) = delete;
+
+  // adds m in the calling thread; m must have the shape of the sum
+  void Add(const S21Matrix& m);
+  S21Accumulator& operator+=(const S21Matrix& m);
+  // the sum of everything added so far; safe to call while others add,
+  // each Add lands entirely before or entirely after it
+  S21Matrix Collect();
+  void Reset();
+
+  int get_Row() const;
+  int get_Col() const;
+  int Shards() const;
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<bool> busy{false};
+    bool used = false;  // sum holds a partial sum, not stale data
+    S21Matrix sum;
+  };
+
+  Shard& Claim() noexcept;
+  void LockAll() noexcept;
+  void UnlockAll() noexcept;
+
+  int rows_, cols_;
+  int shards_;
+  std::unique_ptr<Shard[]> shard_;
+};
+
+#endif
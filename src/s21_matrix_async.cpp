@@ -0,0 +1,375 @@
+#include "s21_matrix_async.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "s21_parallel.h"
+
+// Owned jointly by the graph, its handles and its queued tasks, so a node
+// finishes and a handle reads its result whatever is destroyed first.
+class S21TaskGraph::State : public std::enable_shared_from_this<State> {
+ public:
+  enum class Op {
+    kInput,
+    kSum,
+    kSub,
+    kMulNumber,
+    kMulMatrix,
+    kTranspose,
+    kInverse,
+    kDeterminant
+  };
+  struct Step {  // one element-wise operation of a fused node
+    Op op;
+    int operand;  // node index, -1 for kMulNumber
+    double num;
+  };
+  struct Node {
+    Op op;
+    std::vector<int> inputs;
+    double num = 0;
+    std::weak_ptr<int> token;
+    std::vector<Step> fused;  // element-wise steps, applied in one pass
+    std::vector<int> consumers;  // every node reading this one
+    std::vector<int> waiters;    // launched consumers not started yet
+    int pending = 0;
+    bool launched = false;
+    bool absorbed = false;  // folded into its only consumer
+    bool done = false;
+    std::promise<S21Matrix> matrix;
+    std::shared_future<S21Matrix> matrix_future;
+    std::promise<double> value;
+    std::shared_future<double> value_future;
+  };
+
+  static bool ElementWise(const Op op);
+  S21AsyncMatrix Input(S21Matrix&& m);
+  S21AsyncMatrix AddMatrixNode(Op op, std::vector<int> inputs, double num);
+  S21AsyncScalar AddScalarNode(Op op, int input);
+  int AddNode(Op op, std::vector<int> inputs, double num,
+              const std::shared_ptr<int>& token);
+  void Fuse(const std::vector<int>& fresh);
+  void Launch();
+  void LaunchIfNeeded(const int id);
+  void Wait();
+  void Submit(const std::vector<int>& ready);
+  void Execute(const int id);
+  void Complete(const int id);
+
+  mutable std::mutex mu;
+  std::condition_variable idle_cv;
+  std::deque<Node> nodes;  // stable addresses, indexed by node id
+  int running = 0;
+  int fused = 0;
+};
+
+namespace {
+
+void SameGraph(const void* a, const void* b) {
+  if (a != b) {
+    throw std::invalid_argument("the operands belong to different graphs");
+  }
+}
+
+}  // namespace
+
+S21AsyncMatrix::S21AsyncMatrix(std::shared_ptr<Graph> graph, int node,
+                               std::shared_ptr<int> token)
+    : graph_(std::move(graph)), node_(node), token_(std::move(token)) {}
+
+S21AsyncMatrix S21AsyncMatrix::SumMatrixAsync(const S21AsyncMatrix& o) const {
+  SameGraph(graph_.get(), o.graph_.get());
+  return graph_->AddMatrixNode(Graph::Op::kSum, {node_, o.node_}, 0);
+}
+
+S21AsyncMatrix S21AsyncMatrix::SubMatrixAsync(const S21AsyncMatrix& o) const {
+  SameGraph(graph_.get(), o.graph_.get());
+  return graph_->AddMatrixNode(Graph::Op::kSub, {node_, o.node_}, 0);
+}
+
+S21AsyncMatrix S21AsyncMatrix::MulNumberAsync(const double num) const {
+  return graph_->AddMatrixNode(Graph::Op::kMulNumber, {node_}, num);
+}
+
+S21AsyncMatrix S21AsyncMatrix::MulMatrixAsync(const S21AsyncMatrix& o) const {
+  SameGraph(graph_.get(), o.graph_.get());
+  return graph_->AddMatrixNode(Graph::Op::kMulMatrix, {node_, o.node_}, 0);
+}
+
+S21AsyncMatrix S21AsyncMatrix::TransposeAsync() const {
+  return graph_->AddMatrixNode(Graph::Op::kTranspose, {node_}, 0);
+}
+
+S21AsyncMatrix S21AsyncMatrix::InverseAsync() const {
+  return graph_->AddMatrixNode(Graph::Op::kInverse, {node_}, 0);
+}
+
+S21AsyncScalar S21AsyncMatrix::DeterminantAsync() const {
+  return graph_->AddScalarNode(Graph::Op::kDeterminant, node_);
+}
+
+std::shared_future<S21Matrix> S21AsyncMatrix::future() const {
+  graph_->LaunchIfNeeded(node_);
+  std::lock_guard<std::mutex> lock(graph_->mu);
+  return graph_->nodes[node_].matrix_future;
+}
+
+S21Matrix S21AsyncMatrix::get() const { return future().get(); }
+
+S21AsyncScalar::S21AsyncScalar(std::shared_ptr<Graph> graph, int node,
+                               std::shared_ptr<int> token)
+    : graph_(std::move(graph)), node_(node), token_(std::move(token)) {}
+
+std::shared_future<double> S21AsyncScalar::future() const {
+  graph_->LaunchIfNeeded(node_);
+  std::lock_guard<std::mutex> lock(graph_->mu);
+  return graph_->nodes[node_].value_future;
+}
+
+double S21AsyncScalar::get() const { return future().get(); }
+
+S21TaskGraph::S21TaskGraph() : state_(std::make_shared<State>()) {}
+
+S21TaskGraph::~S21TaskGraph() { state_->Wait(); }
+
+S21AsyncMatrix S21TaskGraph::Input(const S21Matrix& m) {
+  return state_->Input(S21Matrix(m));
+}
+
+S21AsyncMatrix S21TaskGraph::Input(S21Matrix&& m) {
+  return state_->Input(std::move(m));
+}
+
+void S21TaskGraph::Launch() { state_->Launch(); }
+
+void S21TaskGraph::Wait() { state_->Wait(); }
+
+int S21TaskGraph::FusedNodes() const {
+  std::lock_guard<std::mutex> lock(state_->mu);
+  return state_->fused;
+}
+
+bool S21TaskGraph::State::ElementWise(const Op op) {
+  return op == Op::kSum || op == Op::kSub || op == Op::kMulNumber;
+}
+
+S21AsyncMatrix S21TaskGraph::State::Input(S21Matrix&& m) {
+  std::shared_ptr<int> token = std::make_shared<int>(0);
+  const int id = AddNode(Op::kInput, {}, 0, token);
+  std::lock_guard<std::mutex> lock(mu);
+  Node& node = nodes[id];
+  node.matrix.set_value(std::move(m));
+  node.launched = true;
+  node.done = true;
+  return S21AsyncMatrix(shared_from_this(), id, token);
+}
+
+S21AsyncMatrix S21TaskGraph::State::AddMatrixNode(Op op,
+                                                  std::vector<int> inputs,
+                                                  double num) {
+  std::shared_ptr<int> token = std::make_shared<int>(0);
+  const int id = AddNode(op, std::move(inputs), num, token);
+  return S21AsyncMatrix(shared_from_this(), id, token);
+}
+
+S21AsyncScalar S21TaskGraph::State::AddScalarNode(Op op, int input) {
+  std::shared_ptr<int> token = std::make_shared<int>(0);
+  const int id = AddNode(op, {input}, 0, token);
+  return S21AsyncScalar(shared_from_this(), id, token);
+}
+
+int S21TaskGraph::State::AddNode(Op op, std::vector<int> inputs, double num,
+                                 const std::shared_ptr<int>& token) {
+  std::lock_guard<std::mutex> lock(mu);
+  const int id = static_cast<int>(nodes.size());
+  nodes.emplace_back();
+  Node& node = nodes.back();
+  node.op = op;
+  node.num = num;
+  node.token = token;
+  for (int input : inputs) nodes[input].consumers.push_back(id);
+  if (ElementWise(op)) {
+    // inputs[0] is the running value, every step folds one operand into it
+    node.fused.push_back({op, inputs.size() > 1 ? inputs[1] : -1, num});
+    inputs.resize(1);
+  }
+  node.inputs = std::move(inputs);
+  if (op == Op::kDeterminant) {
+    node.value_future = node.value.get_future().share();
+  } else {
+    node.matrix_future = node.matrix.get_future().share();
+  }
+  return id;
+}
+
+// Folds x into its consumer n when both are element-wise, not launched
+// yet, n is the only consumer of x and no handle to x is left.
+void S21TaskGraph::State::Fuse(const std::vector<int>& fresh) {
+  for (int id : fresh) {
+    Node& n = nodes[id];
+    if (!ElementWise(n.op)) continue;
+    Node& x = nodes[n.inputs[0]];
+    if (x.launched || !ElementWise(x.op) || !x.token.expired() ||
+        x.consumers.size() != 1) {
+      continue;
+    }
+    n.inputs[0] = x.inputs[0];
+    n.fused.insert(n.fused.begin(), x.fused.begin(), x.fused.end());
+    x.absorbed = true;
+    x.launched = true;
+    ++fused;
+  }
+}
+
+void S21TaskGraph::State::Launch() {
+  std::vector<int> ready;
+  std::unique_lock<std::mutex> lock(mu);
+  std::vector<int> fresh;
+  for (int id = 0; id < static_cast<int>(nodes.size()); ++id) {
+    if (!nodes[id].launched) fresh.push_back(id);
+  }
+  Fuse(fresh);
+  for (int id : fresh) {
+    Node& n = nodes[id];
+    if (n.absorbed) continue;
+    n.launched = true;
+    std::vector<int> deps = n.inputs;
+    for (const Step& s : n.fused) {
+      if (s.operand >= 0) deps.push_back(s.operand);
+    }
+    for (int d : deps) {
+      if (!nodes[d].done) {
+        nodes[d].waiters.push_back(id);
+        ++n.pending;
+      }
+    }
+    if (n.pending == 0) {
+      ready.push_back(id);
+      ++running;
+    }
+  }
+  lock.unlock();
+  Submit(ready);
+}
+
+void S21TaskGraph::State::LaunchIfNeeded(const int id) {
+  bool launched;
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    launched = nodes[id].launched;
+  }
+  if (!launched) Launch();
+}
+
+void S21TaskGraph::State::Wait() {
+  std::unique_lock<std::mutex> lock(mu);
+  idle_cv.wait(lock, [this] { return running == 0; });
+}
+
+// Called without mu, already counted in running: an inline pool runs the
+// task right here, and the task locks mu. The task keeps the state alive
+// until it is done.
+void S21TaskGraph::State::Submit(const std::vector<int>& ready) {
+  for (int id : ready) {
+    try {
+      S21ThreadPool::Instance().Submit([self = shared_from_this(), id] {
+        self->Execute(id);
+        self->Complete(id);
+      });
+    } catch (const std::exception&) {
+      // no task thread to take it: run it here
+      Execute(id);
+      Complete(id);
+    }
+  }
+}
+
+void S21TaskGraph::State::Execute(const int id) {
+  Node* n;
+  std::vector<std::shared_future<S21Matrix>> in;
+  std::vector<std::shared_future<S21Matrix>> operands;
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    n = &nodes[id];
+    for (int i : n->inputs) in.push_back(nodes[i].matrix_future);
+    for (const Step& s : n->fused) {
+      operands.push_back(s.operand >= 0 ? nodes[s.operand].matrix_future
+                                        : std::shared_future<S21Matrix>());
+    }
+  }
+  try {
+    if (n->op == Op::kDeterminant) {
+      S21Matrix workspace(1, 1);
+      n->value.set_value(in[0].get().DeterminantInto(workspace));
+      return;
+    }
+    S21Matrix res(1, 1);
+    if (ElementWise(n->op)) {
+      res = in[0].get();
+      std::vector<const S21Matrix*> rhs(n->fused.size(), nullptr);
+      for (std::size_t s = 0; s < n->fused.size(); ++s) {
+        if (!operands[s].valid()) continue;
+        rhs[s] = &operands[s].get();
+        if (rhs[s]->get_Row() != res.get_Row() ||
+            rhs[s]->get_Col() != res.get_Col()) {
+          throw std::out_of_range(
+              "Incorrect input, matrices should have the same size");
+        }
+      }
+      // all steps are applied to a row while it is in cache
+      const int cols = res.get_Col();
+      const long cost = long(cols) * n->fused.size();
+      S21ThreadPool::Instance().ParallelFor(
+          0, res.get_Row(), cost, [&](int lo, int hi) {
+            for (int i = lo; i < hi; ++i) {
+              double* row = res.data(i);
+              for (std::size_t s = 0; s < n->fused.size(); ++s) {
+                const Step& step = n->fused[s];
+                const double* o = rhs[s] ? rhs[s]->data(i) : nullptr;
+                if (step.op == Op::kSum) {
+                  for (int j = 0; j < cols; ++j) row[j] += o[j];
+                } else if (step.op == Op::kSub) {
+                  for (int j = 0; j < cols; ++j) row[j] -= o[j];
+                } else {
+                  for (int j = 0; j < cols; ++j) row[j] *= step.num;
+                }
+              }
+            }
+          });
+    } else if (n->op == Op::kMulMatrix) {
+      S21Matrix::MulInto(in[0].get(), in[1].get(), res);
+    } else if (n->op == Op::kTranspose) {
+      in[0].get().TransposeInto(res);
+    } else if (n->op == Op::kInverse) {
+      S21Matrix workspace(1, 1);
+      in[0].get().InverseInto(res, workspace);
+    }
+    n->matrix.set_value(std::move(res));
+  } catch (...) {
+    if (n->op == Op::kDeterminant) {
+      n->value.set_exception(std::current_exception());
+    } else {
+      n->matrix.set_exception(std::current_exception());
+    }
+  }
+}
+
+void S21TaskGraph::State::Complete(const int id) {
+  std::vector<int> ready;
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    Node& n = nodes[id];
+    n.done = true;
+    for (int w : n.waiters) {
+      if (--nodes[w].pending == 0) {
+        ready.push_back(w);
+        ++running;
+      }
+    }
+    n.waiters.clear();
+    if (--running == 0) idle_cv.notify_all();
+  }
+  Submit(ready);
+}
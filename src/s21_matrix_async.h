@@ -0,0 +1,88 @@
+#ifndef __S21_MATRIX_ASYNC_H__
+#define __S21_MATRIX_ASYNC_H__
+
+#include <future>
+#include <memory>
+
+#include "s21_matrix_oop.h"
+
+class S21AsyncMatrix;
+class S21AsyncScalar;
+
+// Dependency DAG of matrix operations executed on the library thread pool.
+// Independent nodes run concurrently; a chain of element-wise nodes whose
+// intermediate results nobody holds a handle to is fused into one pass.
+// Nodes run on the task threads of the pool, not on its workers, so a large
+// node still spreads over every worker while small independent nodes run
+// side by side. Handles share the graph state and stay valid after the
+// graph object is gone.
+class S21TaskGraph {
+ public:
+  S21TaskGraph();
+  S21TaskGraph(const S21TaskGraph&) = delete;
+  S21TaskGraph& operator=(const S21TaskGraph&) = delete;
+  ~S21TaskGraph();  // waits for launched nodes
+
+  S21AsyncMatrix Input(const S21Matrix& m);
+  S21AsyncMatrix Input(S21Matrix&& m);
+
+  // schedules every node recorded since the previous launch
+  void Launch();
+  void Wait();
+  int FusedNodes() const;
+
+ private:
+  friend class S21AsyncMatrix;
+  friend class S21AsyncScalar;
+  class State;  // nodes and scheduling, shared with handles and tasks
+
+  std::shared_ptr<State> state_;
+};
+
+// Handle to a matrix-valued node of an S21TaskGraph. Chained calls only
+// record the operation; nothing runs until the graph is launched. Both
+// operands of a binary operation must come from the same graph.
+class S21AsyncMatrix {
+ public:
+  S21AsyncMatrix SumMatrixAsync(const S21AsyncMatrix& o) const;
+  S21AsyncMatrix SubMatrixAsync(const S21AsyncMatrix& o) const;
+  S21AsyncMatrix MulNumberAsync(const double num) const;
+  S21AsyncMatrix MulMatrixAsync(const S21AsyncMatrix& o) const;
+  S21AsyncMatrix TransposeAsync() const;
+  S21AsyncMatrix InverseAsync() const;
+  S21AsyncScalar DeterminantAsync() const;
+
+  // launches the graph if needed; rethrows the error of the operation
+  std::shared_future<S21Matrix> future() const;
+  S21Matrix get() const;
+
+ private:
+  friend class S21TaskGraph;
+  friend class S21TaskGraph::State;
+  using Graph = S21TaskGraph::State;
+  S21AsyncMatrix(std::shared_ptr<Graph> graph, int node,
+                 std::shared_ptr<int> token);
+
+  std::shared_ptr<Graph> graph_;
+  int node_;
+  std::shared_ptr<int> token_;  // tells the graph a handle is still alive
+};
+
+class S21AsyncScalar {
+ public:
+  std::shared_future<double> future() const;
+  double get() const;
+
+ private:
+  friend class S21TaskGraph;
+  friend class S21TaskGraph::State;
+  using Graph = S21TaskGraph::State;
+  S21AsyncScalar(std::shared_ptr<Graph> graph, int node,
+                 std::shared_ptr<int> token);
+
+  std::shared_ptr<Graph> graph_;
+  int node_;
+  std::shared_ptr<int> token_;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "s21_matrix_cache.h"
+
+#include <iterator>
+
+double S21ResultCache::Stats::HitRate() const {
+  const long total = hits + misses;
+  return total ? double(hits) / total : 0;
+}
+
+S21ResultCache::S21ResultCache(std::size_t capacity, const S21Tolerance& tol)
+    : capacity_(capacity), tol_(tol) {
+  if (capacity < 1) {
+    throw std::invalid_argument("S21ResultCache: invalid capacity");
+  }
+}
+
+std::size_t S21ResultCache::KeyOf(Kind kind, const S21Matrix& m,
+                                  const S21Tolerance& tol) {
+  return m.Hash(tol) ^ (kind == Kind::kInverse ? 0x5bd1e995 : 0x27d4eb2f);
+}
+
+S21ResultCache::Lru::iterator S21ResultCache::Find(Kind kind,
+                                                   std::size_t hash,
+                                                   const S21Matrix& m) {
+  auto range = index_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    Entry& e = *it->second;
+    if (e.kind == kind && e.key.EqMatrix(m, tol_)) {
+      lru_.splice(lru_.begin(), lru_, it->second);
+      return it->second;
+    }
+  }
+  return lru_.end();
+}
+
+void S21ResultCache::Insert(Entry entry) {
+  std::lock_guard<std::mutex> lock(mu_);
+  if (Find(entry.kind, entry.hash, entry.key) != lru_.end()) {
+    return;  // another thread computed it meanwhile
+  }
+  lru_.push_front(std::move(entry));
+  index_.emplace(lru_.front().hash, lru_.begin());
+  while (lru_.size() > capacity_) {
+    auto range = index_.equal_range(lru_.back().hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == std::prev(lru_.end())) {
+        index_.erase(it);
+        break;
+      }
+    }
+    lru_.pop_back();
+    ++stats_.evictions;
+  }
+}
+
+S21Matrix S21ResultCache::InverseMatrix(const S21Matrix& m) {
+  const std::size_t hash = KeyOf(Kind::kInverse, m, tol_);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = Find(Kind::kInverse, hash, m);
+    if (it != lru_.end()) {
+      ++stats_.hits;
+      return it->inverse;
+    }
+    ++stats_.misses;
+  }
+  S21Matrix inverse(1, 1), workspace(1, 1);
+  m.InverseInto(inverse, workspace);
+  Insert({Kind::kInverse, hash, m, inverse, 0});
+  return inverse;
+}
+
+double S21ResultCache::Determinant(const S21Matrix& m) {
+  const std::size_t hash = KeyOf(Kind::kDeterminant, m, tol_);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = Find(Kind::kDeterminant, hash, m);
+    if (it != lru_.end()) {
+      ++stats_.hits;
+      return it->determinant;
+    }
+    ++stats_.misses;
+  }
+  S21Matrix workspace(1, 1);
+  const double det = m.DeterminantInto(workspace);
+  Insert({Kind::kDeterminant, hash, m, S21Matrix(1, 1), det});
+  return det;
+}
+
+S21ResultCache::Stats S21ResultCache::get_Stats() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return stats_;
+}
+
+std::size_t S21ResultCache::Size() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  return lru_.size();
+}
+
+void S21ResultCache::Clear() {
+  std::lock_guard<std::mutex> lock(mu_);
+  lru_.clear();
+  index_.clear();
+}
@@ -0,0 +1,59 @@
+#ifndef __S21_MATRIX_CACHE_H__
+#define __S21_MATRIX_CACHE_H__
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "s21_matrix_oop.h"
+
+// Memoizes expensive results keyed by the tolerance-quantized content hash
+// of the argument. A hit needs an equal hash and EqMatrix(tol), so results
+// are only ever shared between matrices the tolerance considers equal.
+// Least recently used entries are evicted beyond capacity. Thread-safe.
+class S21ResultCache {
+ public:
+  struct Stats {
+    long hits = 0;
+    long misses = 0;
+    long evictions = 0;
+    double HitRate() const;
+  };
+
+  explicit S21ResultCache(std::size_t capacity,
+                          const S21Tolerance& tol = S21Tolerance());
+
+  S21Matrix InverseMatrix(const S21Matrix& m);
+  double Determinant(const S21Matrix& m);
+
+  Stats get_Stats() const;
+  std::size_t Size() const;
+  void Clear();
+
+ private:
+  enum class Kind { kInverse, kDeterminant };
+  struct Entry {
+    Kind kind;
+    std::size_t hash;
+    S21Matrix key;
+    S21Matrix inverse;
+    double determinant;
+  };
+  using Lru = std::list<Entry>;
+
+  static std::size_t KeyOf(Kind kind, const S21Matrix& m,
+                           const S21Tolerance& tol);
+  // with mu_ held; moves a hit to the front of the LRU list
+  Lru::iterator Find(Kind kind, std::size_t hash, const S21Matrix& m);
+  void Insert(Entry entry);
+
+  std::size_t capacity_;
+  S21Tolerance tol_;
+  mutable std::mutex mu_;
+  Lru lru_;  // most recently used first
+  std::unordered_multimap<std::size_t, Lru::iterator> index_;
+  Stats stats_;
+};
+
+#endif
@@ -0,0 +1,951 @@
+#include "s21_matrix_dist.h"
+
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#ifdef S21_HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include "s21_parallel.h"
+
+namespace {
+
+void WriteAll(const int fd, const void* buf, std::size_t bytes) {
+  const char* p = static_cast<const char*>(buf);
+  while (bytes > 0) {
+    const ssize_t n = ::send(fd, p, bytes, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      throw std::runtime_error("S21SocketCommunicator: send failed");
+    }
+    p += n;
+    bytes -= n;
+  }
+}
+
+void ReadAll(const int fd, void* buf, std::size_t bytes) {
+  char* p = static_cast<char*>(buf);
+  while (bytes > 0) {
+    const ssize_t n = ::recv(fd, p, bytes, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      throw std::runtime_error("S21SocketCommunicator: peer disconnected");
+    }
+    p += n;
+    bytes -= n;
+  }
+}
+
+sockaddr_un SocketAddress(const std::string& path) {
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::invalid_argument("S21SocketCommunicator: socket path too long");
+  }
+  std::memcpy(addr.sun_path, path.c_str(), path.size());
+  return addr;
+}
+
+// number of rows (or cols) of an n-long dimension dealt to process p of np
+int Numroc(const int n, const int nb, const int p, const int np) {
+  const int blocks = n / nb;
+  int count = (blocks / np) * nb;
+  const int extra = blocks % np;
+  if (p < extra) {
+    count += nb;
+  } else if (p == extra) {
+    count += n % nb;
+  }
+  return count;
+}
+
+// rows of the most square process grid that uses every process
+int GridRows(const int size) {
+  int rows = 1;
+  for (int r = 1; r * r <= size; ++r) {
+    if (size % r == 0) rows = r;
+  }
+  return rows;
+}
+
+double AllReduceMax(S21Communicator& comm, double value) {
+  if (comm.Rank() == 0) {
+    for (int r = 1; r < comm.Size(); ++r) {
+      double other = 0;
+      comm.Recv(r, &other, 1);
+      value = std::max(value, other);
+    }
+    for (int r = 1; r < comm.Size(); ++r) comm.Send(r, &value, 1);
+  } else {
+    comm.Send(0, &value, 1);
+    comm.Recv(0, &value, 1);
+  }
+  return value;
+}
+
+}  // namespace
+
+void S21Communicator::Exchange(const int peer, const double* send,
+                               double* recv, const std::size_t count) {
+  if (Rank() < peer) {
+    Send(peer, send, count);
+    Recv(peer, recv, count);
+  } else {
+    Recv(peer, recv, count);
+    Send(peer, send, count);
+  }
+}
+
+S21SocketCommunicator::S21SocketCommunicator(const int rank,
+                                             std::vector<int> fds)
+    : rank_(rank), fds_(std::move(fds)) {}
+
+S21SocketCommunicator::S21SocketCommunicator(
+    S21SocketCommunicator&& o) noexcept
+    : rank_(o.rank_), fds_(std::move(o.fds_)) {
+  o.fds_.clear();
+}
+
+S21SocketCommunicator::~S21SocketCommunicator() {
+  for (int fd : fds_) {
+    if (fd >= 0) ::close(fd);
+  }
+}
+
+void S21SocketCommunicator::Spawn(
+    const int processes, const std::function<void(S21Communicator&)>& body) {
+  if (processes < 1) {
+    throw std::invalid_argument("Spawn: invalid number of processes");
+  }
+  std::vector<std::vector<int>> fds(processes,
+                                    std::vector<int>(processes, -1));
+  for (int a = 0; a < processes; ++a) {
+    for (int b = a + 1; b < processes; ++b) {
+      int sv[2];
+      if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        throw std::runtime_error("Spawn: socketpair failed");
+      }
+      fds[a][b] = sv[0];
+      fds[b][a] = sv[1];
+    }
+  }
+  auto close_others = [&](const int keep) {
+    for (int a = 0; a < processes; ++a) {
+      if (a == keep) continue;
+      for (int fd : fds[a]) {
+        if (fd >= 0) ::close(fd);
+      }
+    }
+  };
+  std::vector<pid_t> children;
+  for (int r = 1; r < processes; ++r) {
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+      close_others(r);
+      int status = 0;
+      try {
+        S21SocketCommunicator comm(r, fds[r]);
+        body(comm);
+      } catch (...) {
+        status = 1;
+      }
+      ::_exit(status);
+    }
+    if (pid < 0) {
+      close_others(-1);
+      for (pid_t child : children) {
+        ::kill(child, SIGKILL);
+        while (::waitpid(child, nullptr, 0) < 0 && errno == EINTR) {
+        }
+      }
+      throw std::runtime_error("Spawn: fork failed");
+    }
+    children.push_back(pid);
+  }
+  close_others(0);
+  std::exception_ptr error;
+  try {
+    // closing our sockets on failure unblocks the children
+    S21SocketCommunicator comm(0, fds[0]);
+    body(comm);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  bool failed = false;
+  for (pid_t pid : children) {
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+  }
+  if (error) std::rethrow_exception(error);
+  if (failed) {
+    throw std::runtime_error("Spawn: a worker process failed");
+  }
+}
+
+S21SocketCommunicator S21SocketCommunicator::Connect(const std::string& prefix,
+                                                     const int rank,
+                                                     const int size) {
+  if (rank < 0 || rank >= size) {
+    throw std::invalid_argument("Connect: rank out of range");
+  }
+  std::vector<int> fds(size, -1);
+  S21SocketCommunicator comm(rank, fds);
+  const std::string own = prefix + "." + std::to_string(rank);
+  const sockaddr_un own_addr = SocketAddress(own);
+  const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ::unlink(own.c_str());
+  if (listener < 0 ||
+      ::bind(listener, reinterpret_cast<const sockaddr*>(&own_addr),
+             sizeof(own_addr)) != 0 ||
+      ::listen(listener, size) != 0) {
+    if (listener >= 0) ::close(listener);
+    throw std::runtime_error("Connect: cannot listen on " + own);
+  }
+  try {
+    // lower ranks are dialed, higher ranks dial us
+    for (int peer = 0; peer < rank; ++peer) {
+      const sockaddr_un addr =
+          SocketAddress(prefix + "." + std::to_string(peer));
+      const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      comm.fds_[peer] = fd;
+      int attempts = 0;
+      while (::connect(fd, reinterpret_cast<const sockaddr*>(&addr),
+                       sizeof(addr)) != 0) {
+        if (++attempts > 6000) {
+          throw std::runtime_error("Connect: peer did not come up");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      WriteAll(fd, &rank, sizeof(rank));
+    }
+    for (int n = rank + 1; n < size; ++n) {
+      const int fd = ::accept(listener, nullptr, nullptr);
+      if (fd < 0) {
+        throw std::runtime_error("Connect: accept failed");
+      }
+      int peer = -1;
+      ReadAll(fd, &peer, sizeof(peer));
+      if (peer <= rank || peer >= size || comm.fds_[peer] >= 0) {
+        ::close(fd);
+        throw std::runtime_error("Connect: unexpected peer");
+      }
+      comm.fds_[peer] = fd;
+    }
+  } catch (...) {
+    ::close(listener);
+    ::unlink(own.c_str());
+    throw;
+  }
+  ::close(listener);
+  ::unlink(own.c_str());
+  return comm;
+}
+
+int S21SocketCommunicator::Rank() const { return rank_; }
+
+int S21SocketCommunicator::Size() const {
+  return static_cast<int>(fds_.size());
+}
+
+void S21SocketCommunicator::Send(const int dest, const double* buf,
+                                 const std::size_t count) {
+  WriteAll(fds_.at(dest), buf, count * sizeof(double));
+}
+
+void S21SocketCommunicator::Recv(const int src, double* buf,
+                                 const std::size_t count) {
+  ReadAll(fds_.at(src), buf, count * sizeof(double));
+}
+
+#ifdef S21_HAVE_MPI
+S21MpiCommunicator::S21MpiCommunicator() {
+  int level = MPI_THREAD_SINGLE;
+  MPI_Query_thread(&level);
+  if (level < MPI_THREAD_SERIALIZED) {
+    throw std::runtime_error(
+        "S21MpiCommunicator: MPI_THREAD_SERIALIZED is required");
+  }
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+  MPI_Comm_size(MPI_COMM_WORLD, &size_);
+}
+
+int S21MpiCommunicator::Rank() const { return rank_; }
+
+int S21MpiCommunicator::Size() const { return size_; }
+
+void S21MpiCommunicator::Send(const int dest, const double* buf,
+                              const std::size_t count) {
+  if (MPI_Send(buf, static_cast<int>(count), MPI_DOUBLE, dest, 0,
+               MPI_COMM_WORLD) != MPI_SUCCESS) {
+    throw std::runtime_error("S21MpiCommunicator: send failed");
+  }
+}
+
+void S21MpiCommunicator::Recv(const int src, double* buf,
+                              const std::size_t count) {
+  if (MPI_Recv(buf, static_cast<int>(count), MPI_DOUBLE, src, 0,
+               MPI_COMM_WORLD, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+    throw std::runtime_error("S21MpiCommunicator: receive failed");
+  }
+}
+#endif
+
+S21DistMatrix::S21DistMatrix(S21Communicator& comm, int rows, int cols,
+                             int block)
+    : S21DistMatrix(comm, rows, cols, block, GridRows(comm.Size()),
+                    comm.Size() / GridRows(comm.Size())) {}
+
+S21DistMatrix::S21DistMatrix(S21Communicator& comm, int rows, int cols,
+                             int block, int grid_rows, int grid_cols)
+    : comm_(&comm),
+      rows_(rows),
+      cols_(cols),
+      nb_(block),
+      grid_rows_(grid_rows),
+      grid_cols_(grid_cols) {
+  if (rows < 1 || cols < 1 || block < 1) {
+    throw std::invalid_argument("Invalid argument");
+  }
+  if (grid_rows < 1 || grid_cols < 1 ||
+      grid_rows * grid_cols != comm.Size()) {
+    throw std::invalid_argument("S21DistMatrix: grid does not match comm");
+  }
+  my_row_ = comm.Rank() / grid_cols_;
+  my_col_ = comm.Rank() % grid_cols_;
+  local_rows_ = Numroc(rows_, nb_, my_row_, grid_rows_);
+  local_cols_ = Numroc(cols_, nb_, my_col_, grid_cols_);
+  local_.assign(std::size_t(local_rows_) * local_cols_, 0.0);
+}
+
+int S21DistMatrix::get_Row() const { return rows_; }
+
+int S21DistMatrix::get_Col() const { return cols_; }
+
+int S21DistMatrix::get_Block() const { return nb_; }
+
+int S21DistMatrix::LocalRows() const { return local_rows_; }
+
+int S21DistMatrix::LocalCols() const { return local_cols_; }
+
+int S21DistMatrix::OwnerRow(const int i) const {
+  return (i / nb_) % grid_rows_;
+}
+
+int S21DistMatrix::OwnerCol(const int j) const {
+  return (j / nb_) % grid_cols_;
+}
+
+int S21DistMatrix::LocalRow(const int i) const {
+  return (i / nb_ / grid_rows_) * nb_ + i % nb_;
+}
+
+int S21DistMatrix::LocalCol(const int j) const {
+  return (j / nb_ / grid_cols_) * nb_ + j % nb_;
+}
+
+int S21DistMatrix::GlobalRow(const int li) const {
+  return ((li / nb_) * grid_rows_ + my_row_) * nb_ + li % nb_;
+}
+
+int S21DistMatrix::GlobalCol(const int lj) const {
+  return ((lj / nb_) * grid_cols_ + my_col_) * nb_ + lj % nb_;
+}
+
+int S21DistMatrix::RankOf(const int prow, const int pcol) const {
+  return prow * grid_cols_ + pcol;
+}
+
+double* S21DistMatrix::Row(const int li) {
+  return local_.data() + std::size_t(li) * local_cols_;
+}
+
+const double* S21DistMatrix::Row(const int li) const {
+  return local_.data() + std::size_t(li) * local_cols_;
+}
+
+void S21DistMatrix::Scatter(const S21Matrix& global, const int root) {
+  const bool is_root = comm_->Rank() == root;
+  if (is_root && (global.get_Row() != rows_ || global.get_Col() != cols_)) {
+    throw std::invalid_argument("Scatter: incorrect global matrix size");
+  }
+  std::vector<double> tile;
+  for (int bi = 0; bi * nb_ < rows_; ++bi) {
+    for (int bj = 0; bj * nb_ < cols_; ++bj) {
+      const int owner = RankOf(bi % grid_rows_, bj % grid_cols_);
+      if (!is_root && owner != comm_->Rank()) continue;
+      const int i0 = bi * nb_, j0 = bj * nb_;
+      const int h = std::min(nb_, rows_ - i0), w = std::min(nb_, cols_ - j0);
+      tile.resize(std::size_t(h) * w);
+      if (is_root) {
+        for (int i = 0; i < h; ++i) {
+          std::copy(global.data(i0 + i) + j0, global.data(i0 + i) + j0 + w,
+                    &tile[std::size_t(i) * w]);
+        }
+        if (owner != root) {
+          comm_->Send(owner, tile.data(), tile.size());
+          continue;
+        }
+      } else {
+        comm_->Recv(root, tile.data(), tile.size());
+      }
+      for (int i = 0; i < h; ++i) {
+        std::copy(&tile[std::size_t(i) * w], &tile[std::size_t(i) * w] + w,
+                  Row(LocalRow(i0 + i)) + LocalCol(j0));
+      }
+    }
+  }
+}
+
+void S21DistMatrix::Gather(S21Matrix& out, const int root) const {
+  const bool is_root = comm_->Rank() == root;
+  if (is_root && (out.get_Row() != rows_ || out.get_Col() != cols_)) {
+    out = S21Matrix(rows_, cols_);
+  }
+  std::vector<double> tile;
+  for (int bi = 0; bi * nb_ < rows_; ++bi) {
+    for (int bj = 0; bj * nb_ < cols_; ++bj) {
+      const int owner = RankOf(bi % grid_rows_, bj % grid_cols_);
+      if (!is_root && owner != comm_->Rank()) continue;
+      const int i0 = bi * nb_, j0 = bj * nb_;
+      const int h = std::min(nb_, rows_ - i0), w = std::min(nb_, cols_ - j0);
+      tile.resize(std::size_t(h) * w);
+      if (owner == comm_->Rank()) {
+        for (int i = 0; i < h; ++i) {
+          const double* src = Row(LocalRow(i0 + i)) + LocalCol(j0);
+          std::copy(src, src + w, &tile[std::size_t(i) * w]);
+        }
+        if (!is_root) {
+          comm_->Send(root, tile.data(), tile.size());
+          continue;
+        }
+      } else {
+        comm_->Recv(owner, tile.data(), tile.size());
+      }
+      for (int i = 0; i < h; ++i) {
+        std::copy(&tile[std::size_t(i) * w], &tile[std::size_t(i) * w] + w,
+                  out.data(i0 + i) + j0);
+      }
+    }
+  }
+}
+
+void S21DistMatrix::MulMatrix(const S21DistMatrix& other) {
+  if (cols_ != other.rows_) {
+    throw std::invalid_argument("MulMatrix: cannot multiply matrices");
+  }
+  if (nb_ != other.nb_ || grid_rows_ != other.grid_rows_ ||
+      grid_cols_ != other.grid_cols_ || comm_ != other.comm_) {
+    throw std::invalid_argument("MulMatrix: distributions do not match");
+  }
+  S21DistMatrix res(*comm_, rows_, other.cols_, nb_, grid_rows_, grid_cols_);
+  const int panels = (cols_ + nb_ - 1) / nb_;
+  std::vector<double> a[2], b[2];
+
+  // panel k of A travels along process rows, panel k of B along columns
+  auto fetch = [&](const int k, std::vector<double>& ap,
+                   std::vector<double>& bp) {
+    const int w = std::min(nb_, cols_ - k * nb_);
+    const int a_owner = k % grid_cols_, b_owner = k % grid_rows_;
+    ap.resize(std::size_t(local_rows_) * w);
+    bp.resize(std::size_t(w) * other.local_cols_);
+    if (my_col_ == a_owner) {
+      const int lj = LocalCol(k * nb_);
+      for (int i = 0; i < local_rows_; ++i) {
+        std::copy(Row(i) + lj, Row(i) + lj + w, &ap[std::size_t(i) * w]);
+      }
+      for (int c = 0; c < grid_cols_; ++c) {
+        if (c != my_col_) {
+          comm_->Send(RankOf(my_row_, c), ap.data(), ap.size());
+        }
+      }
+    } else {
+      comm_->Recv(RankOf(my_row_, a_owner), ap.data(), ap.size());
+    }
+    if (my_row_ == b_owner) {
+      const int li = other.LocalRow(k * nb_);
+      std::copy(other.Row(li),
+                other.Row(li) + std::size_t(w) * other.local_cols_,
+                bp.begin());
+      for (int r = 0; r < grid_rows_; ++r) {
+        if (r != my_row_) {
+          comm_->Send(RankOf(r, my_col_), bp.data(), bp.size());
+        }
+      }
+    } else {
+      comm_->Recv(RankOf(b_owner, my_col_), bp.data(), bp.size());
+    }
+  };
+
+  if (panels > 0) fetch(0, a[0], b[0]);
+  // one communication thread fetches panel k + 1 while panel k is
+  // multiplied; it refills a buffer once the panel before has been used.
+  // Without worker threads the panels are fetched in turn.
+  const bool overlap = !S21ThreadPool::Instance().Inline();
+  std::mutex mu;
+  std::condition_variable cv;
+  int fetched = 1, used = 0;
+  std::exception_ptr error;
+  std::thread fetcher;
+  if (panels > 1 && overlap) {
+    fetcher = std::thread([&] {
+      for (int k = 1; k < panels; ++k) {
+        {
+          std::unique_lock<std::mutex> lock(mu);
+          cv.wait(lock, [&] { return used >= k - 1; });
+        }
+        try {
+          fetch(k, a[k % 2], b[k % 2]);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mu);
+          error = std::current_exception();
+          cv.notify_all();
+          return;
+        }
+        std::lock_guard<std::mutex> lock(mu);
+        fetched = k + 1;
+        cv.notify_all();
+      }
+    });
+  }
+  for (int k = 0; k < panels; ++k) {
+    if (!overlap && k > 0) {
+      fetch(k, a[k % 2], b[k % 2]);
+    } else {
+      std::unique_lock<std::mutex> lock(mu);
+      cv.wait(lock, [&] { return fetched > k || error; });
+      if (error) break;
+    }
+    const std::vector<double>& ap = a[k % 2];
+    const std::vector<double>& bp = b[k % 2];
+    const int w = std::min(nb_, cols_ - k * nb_);
+    const int n = res.local_cols_;
+    S21ThreadPool::Instance().ParallelFor(
+        0, local_rows_, long(w) * n, [&](int lo, int hi) {
+          for (int i = lo; i < hi; ++i) {
+            double* c = res.Row(i);
+            for (int x = 0; x < w; ++x) {
+              const double f = ap[std::size_t(i) * w + x];
+              const double* row = &bp[std::size_t(x) * n];
+              for (int j = 0; j < n; ++j) c[j] += f * row[j];
+            }
+          }
+        });
+    std::lock_guard<std::mutex> lock(mu);
+    used = k + 1;
+    cv.notify_all();
+  }
+  if (fetcher.joinable()) fetcher.join();
+  if (error) std::rethrow_exception(error);
+  *this = std::move(res);
+}
+
+// Factors the nb-wide panel of columns [k0, k0 + w) on the process column
+// that owns it and hands every process row its share. msg is laid out as
+// {status, determinant factor, w pivot rows, local_rows_ x w panel}; the
+// panel holds L \ U of the pivoted rows and, for Gauss-Jordan, the pivoted
+// original values of every other row, which are its multipliers. Only the
+// pivot search, swaps and pivot rows inside the panel travel per column,
+// and only within the process column.
+void S21DistMatrix::FetchPanel(const int k0, const int w, const bool jordan,
+                               const double eps, std::vector<double>& msg) {
+  const int pk = OwnerCol(k0), rk = OwnerRow(k0);
+  msg.assign(2 + w + std::size_t(local_rows_) * w, 0);
+  if (my_col_ != pk) {
+    comm_->Recv(RankOf(my_row_, pk), msg.data(), msg.size());
+    return;
+  }
+  double* pivots = msg.data() + 2;
+  double* panel = pivots + w;
+  const int lj0 = LocalCol(k0);
+  for (int li = 0; li < local_rows_; ++li) {
+    std::copy(Row(li) + lj0, Row(li) + lj0 + w, panel + std::size_t(li) * w);
+  }
+  std::vector<double> orig;
+  if (jordan) orig.assign(panel, panel + std::size_t(local_rows_) * w);
+  int lk0 = 0;  // first local row at or below k0
+  while (lk0 < local_rows_ && GlobalRow(lk0) < k0) ++lk0;
+  const int leader = RankOf(rk, pk);
+  const int span = jordan ? 2 * w : w;
+  std::vector<double> mine(span), theirs(span), urow(w);
+  double status = 1, factor = 1;
+  for (int j = 0; j < w; ++j) {
+    const int c = k0 + j;
+    double best[2] = {-1, 0};  // global row, value
+    for (int li = lk0; li < local_rows_; ++li) {
+      const double v = panel[std::size_t(li) * w + j];
+      if (GlobalRow(li) >= c && (best[0] < 0 || fabs(v) > fabs(best[1]))) {
+        best[0] = GlobalRow(li);
+        best[1] = v;
+      }
+    }
+    double pivot[2] = {best[0], best[1]};
+    if (comm_->Rank() != leader) {
+      comm_->Send(leader, best, 2);
+      comm_->Recv(leader, pivot, 2);
+    } else {
+      for (int r = 0; r < grid_rows_; ++r) {
+        if (r == rk) continue;
+        double cand[2];
+        comm_->Recv(RankOf(r, pk), cand, 2);
+        const bool better = fabs(cand[1]) > fabs(pivot[1]) ||
+                            (fabs(cand[1]) == fabs(pivot[1]) &&
+                             cand[0] < pivot[0]);
+        if (cand[0] >= 0 && (pivot[0] < 0 || better)) {
+          std::copy(cand, cand + 2, pivot);
+        }
+      }
+      for (int r = 0; r < grid_rows_; ++r) {
+        if (r != rk) comm_->Send(RankOf(r, pk), pivot, 2);
+      }
+    }
+    const int p = static_cast<int>(pivot[0]);
+    const double value = pivot[1];
+    if (!(fabs(value) > eps)) {
+      status = 0;
+      break;
+    }
+    pivots[j] = p;
+    factor *= p != c ? -value : value;
+
+    if (p != c) {
+      const int rp = OwnerRow(p);
+      auto pack = [&](const int li, double* out) {
+        std::copy(panel + std::size_t(li) * w, panel + std::size_t(li + 1) * w,
+                  out);
+        if (jordan) {
+          std::copy(&orig[std::size_t(li) * w], &orig[std::size_t(li) * w] + w,
+                    out + w);
+        }
+      };
+      auto unpack = [&](const int li, const double* in) {
+        std::copy(in, in + w, panel + std::size_t(li) * w);
+        if (jordan) std::copy(in + w, in + 2 * w, &orig[std::size_t(li) * w]);
+      };
+      if (my_row_ == rk && my_row_ == rp) {
+        pack(LocalRow(c), mine.data());
+        pack(LocalRow(p), theirs.data());
+        unpack(LocalRow(c), theirs.data());
+        unpack(LocalRow(p), mine.data());
+      } else if (my_row_ == rk || my_row_ == rp) {
+        const int li = my_row_ == rk ? LocalRow(c) : LocalRow(p);
+        pack(li, mine.data());
+        comm_->Exchange(RankOf(my_row_ == rk ? rp : rk, pk), mine.data(),
+                        theirs.data(), span);
+        unpack(li, theirs.data());
+      }
+    }
+
+    if (my_row_ == rk) {
+      const double* row = panel + std::size_t(LocalRow(c)) * w;
+      std::copy(row, row + w, urow.begin());
+      for (int r = 0; r < grid_rows_; ++r) {
+        if (r != rk) comm_->Send(RankOf(r, pk), urow.data(), w);
+      }
+    } else {
+      comm_->Recv(leader, urow.data(), w);
+    }
+    for (int li = lk0; li < local_rows_; ++li) {
+      if (GlobalRow(li) <= c) continue;
+      double* row = panel + std::size_t(li) * w;
+      const double l = row[j] / value;
+      row[j] = l;
+      for (int t = j + 1; t < w; ++t) row[t] -= l * urow[t];
+    }
+  }
+  if (jordan) {
+    for (int li = 0; li < local_rows_; ++li) {
+      const int gi = GlobalRow(li);
+      if (gi >= k0 && gi < k0 + w) continue;
+      std::copy(&orig[std::size_t(li) * w], &orig[std::size_t(li) * w] + w,
+                panel + std::size_t(li) * w);
+    }
+  }
+  msg[0] = status;
+  msg[1] = factor;
+  for (int c = 0; c < grid_cols_; ++c) {
+    if (c != pk) comm_->Send(RankOf(my_row_, c), msg.data(), msg.size());
+  }
+}
+
+// Applies the pivots of the panel at k0 to local columns [first, end) in
+// one trade per pair of process rows instead of one exchange per pivot.
+void S21DistMatrix::SwapRows(const int k0, const int w, const double* pivots,
+                             const int first) {
+  const int width = local_cols_ - first;
+  if (width <= 0) return;
+  // global row -> global row whose values it receives
+  std::map<int, int> source;
+  auto at = [&](const int g) -> int& {
+    return source.emplace(g, g).first->second;
+  };
+  for (int j = 0; j < w; ++j) {
+    std::swap(at(k0 + j), at(static_cast<int>(pivots[j])));
+  }
+  std::vector<std::vector<double>> out(grid_rows_);
+  std::vector<std::vector<int>> in(grid_rows_);
+  std::vector<std::pair<int, std::vector<double>>> moves;
+  for (const auto& e : source) {
+    const int g = e.first, s = e.second;
+    if (g == s) continue;
+    const int rg = OwnerRow(g), rs = OwnerRow(s);
+    if (rs == my_row_ && rg != my_row_) {
+      const double* row = Row(LocalRow(s)) + first;
+      out[rg].insert(out[rg].end(), row, row + width);
+    } else if (rg == my_row_ && rs == my_row_) {
+      const double* row = Row(LocalRow(s)) + first;
+      moves.emplace_back(LocalRow(g), std::vector<double>(row, row + width));
+    } else if (rg == my_row_) {
+      in[rs].push_back(LocalRow(g));
+    }
+  }
+  std::vector<double> buf;
+  // ascending peers with the lower rank sending first cannot deadlock
+  for (int q = 0; q < grid_rows_; ++q) {
+    if (q == my_row_ || (out[q].empty() && in[q].empty())) continue;
+    const int peer = RankOf(q, my_col_);
+    buf.resize(in[q].size() * std::size_t(width));
+    if (comm_->Rank() < peer) {
+      if (!out[q].empty()) comm_->Send(peer, out[q].data(), out[q].size());
+      if (!buf.empty()) comm_->Recv(peer, buf.data(), buf.size());
+    } else {
+      if (!buf.empty()) comm_->Recv(peer, buf.data(), buf.size());
+      if (!out[q].empty()) comm_->Send(peer, out[q].data(), out[q].size());
+    }
+    for (std::size_t r = 0; r < in[q].size(); ++r) {
+      std::copy(&buf[r * width], &buf[r * width] + width,
+                Row(in[q][r]) + first);
+    }
+  }
+  for (const auto& m : moves) {
+    std::copy(m.second.begin(), m.second.end(), Row(m.first) + first);
+  }
+}
+
+// Right-looking blocked elimination with partial pivoting. Per nb-wide
+// block: the owning process column factors the panel and broadcasts it with
+// its pivots along the process rows, the pivots are applied to the other
+// columns in one trade per pair of process rows, the block row is solved
+// against the diagonal block and broadcast down the process columns, and
+// every rank updates its trailing tiles. The next panel is updated first,
+// so a communication thread can factor and broadcast it while the rest of
+// the trailing update runs. LU (det) leaves U in the block rows;
+// Gauss-Jordan (jordan) solves the block row with the whole diagonal block
+// and also eliminates the rows above it.
+bool S21DistMatrix::Eliminate(const bool jordan, double* det) {
+  // the inverse rejects pivots lost in rounding, the determinant only zeros
+  double eps = 0;
+  if (jordan) {
+    double scale = 0;
+    for (double v : local_) scale = std::max(scale, fabs(v));
+    scale = AllReduceMax(*comm_, scale);
+    eps = scale * rows_ * std::numeric_limits<double>::epsilon();
+  }
+  if (det) *det = 1;
+  const int blocks = (rows_ + nb_ - 1) / nb_;
+  auto width = [&](const int b) { return std::min(nb_, rows_ - b * nb_); };
+  std::vector<double> msg[2], ublock;
+  FetchPanel(0, width(0), jordan, eps, msg[0]);
+
+  // block k + 1 is fetched once block k has been broadcast; without worker
+  // threads the panels are fetched in turn
+  const bool overlap = !S21ThreadPool::Instance().Inline();
+  std::mutex mu;
+  std::condition_variable cv;
+  int requested = 0, fetched = 1;
+  bool stop = false;
+  std::exception_ptr error;
+  std::thread fetcher;
+  if (blocks > 1 && overlap) {
+    fetcher = std::thread([&] {
+      for (int b = 1; b < blocks; ++b) {
+        {
+          std::unique_lock<std::mutex> lock(mu);
+          cv.wait(lock, [&] { return requested >= b || stop; });
+          if (stop) return;
+        }
+        try {
+          FetchPanel(b * nb_, width(b), jordan, eps, msg[b % 2]);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mu);
+          error = std::current_exception();
+          cv.notify_all();
+          return;
+        }
+        std::lock_guard<std::mutex> lock(mu);
+        fetched = b + 1;
+        cv.notify_all();
+      }
+    });
+  }
+  auto finish = [&] {
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      stop = true;
+      cv.notify_all();
+    }
+    if (fetcher.joinable()) fetcher.join();
+  };
+
+  bool regular = true;
+  try {
+    for (int b = 0; b < blocks; ++b) {
+      if (overlap && b > 0) {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait(lock, [&] { return fetched > b || error; });
+        if (error) break;
+      }
+      const int k0 = b * nb_, w = width(b);
+      const double* head = msg[b % 2].data();
+      if (head[0] == 0) {
+        regular = false;
+        break;
+      }
+      if (det) *det *= head[1];
+      const double* pivots = head + 2;
+      const double* panel = pivots + w;
+      int first = 0;  // first local column right of the panel
+      while (first < local_cols_ && GlobalCol(first) < k0 + w) ++first;
+      const int width_right = local_cols_ - first;
+      SwapRows(k0, w, pivots, first);
+
+      // block row: L11^-1 A12 for LU, (L11 U11)^-1 A12 for Gauss-Jordan
+      const int rk = OwnerRow(k0);
+      ublock.resize(std::size_t(w) * std::max(0, width_right));
+      if (my_row_ == rk) {
+        const int lk0 = LocalRow(k0);
+        const double* d = panel + std::size_t(lk0) * w;  // diagonal block
+        S21ThreadPool::Instance().ParallelFor(
+            first, local_cols_, long(w) * w, [&](int lo, int hi) {
+              for (int t = 0; t < w; ++t) {
+                double* row = Row(lk0 + t);
+                for (int s = 0; s < t; ++s) {
+                  const double l = d[t * w + s];
+                  const double* src = Row(lk0 + s);
+                  for (int lj = lo; lj < hi; ++lj) row[lj] -= l * src[lj];
+                }
+              }
+              if (!jordan) return;
+              for (int t = w - 1; t >= 0; --t) {
+                double* row = Row(lk0 + t);
+                for (int s = t + 1; s < w; ++s) {
+                  const double u = d[t * w + s];
+                  const double* src = Row(lk0 + s);
+                  for (int lj = lo; lj < hi; ++lj) row[lj] -= u * src[lj];
+                }
+                const double inv = 1.0 / d[t * w + t];
+                for (int lj = lo; lj < hi; ++lj) row[lj] *= inv;
+              }
+            });
+        for (int t = 0; t < w && width_right > 0; ++t) {
+          std::copy(Row(lk0 + t) + first, Row(lk0 + t) + local_cols_,
+                    &ublock[std::size_t(t) * width_right]);
+        }
+        for (int r = 0; r < grid_rows_; ++r) {
+          if (r != rk && !ublock.empty()) {
+            comm_->Send(RankOf(r, my_col_), ublock.data(), ublock.size());
+          }
+        }
+      } else if (!ublock.empty()) {
+        comm_->Recv(RankOf(rk, my_col_), ublock.data(), ublock.size());
+      }
+
+      // rows below the block for LU, all but the block for Gauss-Jordan
+      auto update = [&](const int lo_col, const int hi_col) {
+        S21ThreadPool::Instance().ParallelFor(
+            0, local_rows_, long(w) * (hi_col - lo_col), [&](int lo, int hi) {
+              for (int li = lo; li < hi; ++li) {
+                const int gi = GlobalRow(li);
+                if (gi < k0 + w && (!jordan || gi >= k0)) continue;
+                double* row = Row(li);
+                for (int t = 0; t < w; ++t) {
+                  const double f = panel[std::size_t(li) * w + t];
+                  if (f == 0) continue;
+                  const double* u = &ublock[std::size_t(t) * width_right];
+                  for (int lj = lo_col; lj < hi_col; ++lj) {
+                    row[lj] -= f * u[lj - first];
+                  }
+                }
+              }
+            });
+      };
+      int split = first;
+      if (b + 1 < blocks) {
+        // look ahead: the columns of the next panel first
+        if (my_col_ == OwnerCol(k0 + w)) {
+          split = std::min(local_cols_, first + width(b + 1));
+          update(first, split);
+        }
+        if (overlap) {
+          std::lock_guard<std::mutex> lock(mu);
+          requested = b + 1;
+          cv.notify_all();
+        } else {
+          FetchPanel(k0 + w, width(b + 1), jordan, eps, msg[(b + 1) % 2]);
+        }
+      }
+      update(split, local_cols_);
+    }
+  } catch (...) {
+    finish();
+    throw;
+  }
+  finish();
+  if (error) std::rethrow_exception(error);
+  if (!regular && det) *det = 0;
+  return regular;
+}
+
+double S21DistMatrix::Determinant() const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("Determinant: the matrix is ​​not square");
+  }
+  S21DistMatrix lu(*this);
+  double det = 0;
+  lu.Eliminate(false, &det);
+  return det;
+}
+
+S21DistMatrix S21DistMatrix::InverseMatrix() const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("InverseMatrix: the matrix is ​​not square");
+  }
+  // the identity starts at a multiple of nb * grid_cols, so its columns are
+  // dealt exactly like the columns of the result
+  const int stride = nb_ * grid_cols_;
+  const int offset = (cols_ + stride - 1) / stride * stride;
+  S21DistMatrix aug(*comm_, rows_, offset + cols_, nb_, grid_rows_,
+                    grid_cols_);
+  const int shift = offset / grid_cols_;
+  for (int li = 0; li < local_rows_; ++li) {
+    std::copy(Row(li), Row(li) + local_cols_, aug.Row(li));
+    for (int lj = 0; lj < local_cols_; ++lj) {
+      if (GlobalRow(li) == GlobalCol(lj)) aug.Row(li)[lj + shift] = 1;
+    }
+  }
+  if (!aug.Eliminate(true, nullptr)) {
+    throw std::logic_error("InverseMatrix: determinant is zero");
+  }
+  S21DistMatrix res(*comm_, rows_, cols_, nb_, grid_rows_, grid_cols_);
+  for (int li = 0; li < local_rows_; ++li) {
+    std::copy(aug.Row(li) + shift, aug.Row(li) + shift + local_cols_,
+              res.Row(li));
+  }
+  return res;
+}
@@ -0,0 +1,127 @@
+#ifndef __S21_MATRIX_DIST_H__
+#define __S21_MATRIX_DIST_H__
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "s21_matrix_oop.h"
+
+// Point-to-point transport between the processes of a distributed job.
+// Messages between a pair of ranks arrive in the order they were sent.
+class S21Communicator {
+ public:
+  virtual ~S21Communicator() = default;
+
+  virtual int Rank() const = 0;
+  virtual int Size() const = 0;
+  virtual void Send(const int dest, const double* buf,
+                    const std::size_t count) = 0;
+  virtual void Recv(const int src, double* buf, const std::size_t count) = 0;
+
+  // deadlock-free swap of equally sized buffers with a peer
+  void Exchange(const int peer, const double* send, double* recv,
+                const std::size_t count);
+};
+
+// Unix-domain socket transport for processes on one machine.
+class S21SocketCommunicator : public S21Communicator {
+ public:
+  S21SocketCommunicator(const int rank, std::vector<int> fds);
+  S21SocketCommunicator(S21SocketCommunicator&& o) noexcept;
+  S21SocketCommunicator(const S21SocketCommunicator&) = delete;
+  S21SocketCommunicator& operator=(const S21SocketCommunicator&) = delete;
+  ~S21SocketCommunicator() override;
+
+  // forks processes - 1 children connected by socket pairs and runs body
+  // on every rank; the caller is rank 0. Throws if any child fails.
+  static void Spawn(const int processes,
+                    const std::function<void(S21Communicator&)>& body);
+  // joins a job of independently started processes through the sockets
+  // "<prefix>.<rank>"
+  static S21SocketCommunicator Connect(const std::string& prefix,
+                                       const int rank, const int size);
+
+  int Rank() const override;
+  int Size() const override;
+  void Send(const int dest, const double* buf,
+            const std::size_t count) override;
+  void Recv(const int src, double* buf, const std::size_t count) override;
+
+ private:
+  int rank_;
+  std::vector<int> fds_;  // socket to every peer, -1 for ourselves
+};
+
+#ifdef S21_HAVE_MPI
+// MPI_COMM_WORLD transport. MPI must have been initialized with
+// MPI_Init_thread at MPI_THREAD_SERIALIZED or above: S21DistMatrix talks
+// from a helper thread too, though never from two threads at once.
+class S21MpiCommunicator : public S21Communicator {
+ public:
+  S21MpiCommunicator();
+
+  int Rank() const override;
+  int Size() const override;
+  void Send(const int dest, const double* buf,
+            const std::size_t count) override;
+  void Recv(const int src, double* buf, const std::size_t count) override;
+
+ private:
+  int rank_, size_;
+};
+#endif
+
+// Matrix split into nb x nb tiles dealt 2D block-cyclically over a
+// grid_rows x grid_cols process grid. Every rank keeps only its own tiles,
+// packed into one row-major local array as in ScaLAPACK.
+class S21DistMatrix {
+ public:
+  S21DistMatrix(S21Communicator& comm, int rows, int cols, int block);
+  S21DistMatrix(S21Communicator& comm, int rows, int cols, int block,
+                int grid_rows, int grid_cols);
+
+  // tiles of global (significant on root only) are sent to their owners
+  void Scatter(const S21Matrix& global, const int root);
+  // assembles the matrix on root; out is left untouched on other ranks
+  void Gather(S21Matrix& out, const int root) const;
+
+  // SUMMA: this = this * other, panel broadcasts overlap the local update
+  void MulMatrix(const S21DistMatrix& other);
+  // LU with partial pivoting, same result on every rank
+  double Determinant() const;
+  // Gauss-Jordan with partial pivoting on [A | I]
+  S21DistMatrix InverseMatrix() const;
+
+  int get_Row() const;
+  int get_Col() const;
+  int get_Block() const;
+  int LocalRows() const;
+  int LocalCols() const;
+
+ private:
+  int OwnerRow(const int i) const;
+  int OwnerCol(const int j) const;
+  int LocalRow(const int i) const;  // i must be owned by this process row
+  int LocalCol(const int j) const;
+  int GlobalRow(const int li) const;
+  int GlobalCol(const int lj) const;
+  int RankOf(const int prow, const int pcol) const;
+  double* Row(const int li);
+  const double* Row(const int li) const;
+  bool Eliminate(const bool jordan, double* det);
+  void FetchPanel(const int k0, const int w, const bool jordan,
+                  const double eps, std::vector<double>& msg);
+  void SwapRows(const int k0, const int w, const double* pivots,
+                const int first);
+
+  S21Communicator* comm_;
+  int rows_, cols_, nb_;
+  int grid_rows_, grid_cols_;
+  int my_row_, my_col_;
+  int local_rows_, local_cols_;
+  std::vector<double> local_;  // row-major local_rows_ x local_cols_
+};
+
+#endif
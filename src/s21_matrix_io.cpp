@@ -0,0 +1,581 @@
+#include "s21_matrix_io.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "s21_parallel.h"
+
+namespace {
+
+// Chunks smaller than this are not worth a worker of their own.
+constexpr std::size_t kMinChunk = 1 << 16;
+// Text formatted per batch before it is handed to the sink.
+constexpr std::size_t kBatchBytes = 16 << 20;
+// Longest shortest-round-trip double, "-2.2250738585072014e-308".
+constexpr int kMaxNumber = 24;
+
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+      throw std::runtime_error("cannot open " + path + ": " +
+                               std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+      ::close(fd_);
+      throw std::runtime_error("cannot stat " + path);
+    }
+    size_ = st.st_size;
+    if (size_ == 0) return;
+    void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED) {
+      ::close(fd_);
+      throw std::runtime_error("cannot map " + path);
+    }
+    ::madvise(p, size_, MADV_WILLNEED);
+    data_ = static_cast<const char*>(p);
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() {
+    if (data_ != nullptr) ::munmap(const_cast<char*>(data_), size_);
+    ::close(fd_);
+  }
+
+  std::string_view Text() const { return std::string_view(data_, size_); }
+
+ private:
+  int fd_ = -1;
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+class FileSink {
+ public:
+  explicit FileSink(const std::string& path) : path_(path) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+      throw std::runtime_error("cannot create " + path + ": " +
+                               std::strerror(errno));
+    }
+  }
+  FileSink(const FileSink&) = delete;
+  FileSink& operator=(const FileSink&) = delete;
+  ~FileSink() {
+    if (fd_ >= 0) ::close(fd_);
+  }
+
+  void operator()(const std::string& text) {
+    const char* p = text.data();
+    std::size_t bytes = text.size();
+    while (bytes > 0) {
+      const ssize_t n = ::write(fd_, p, bytes);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) throw std::runtime_error("cannot write " + path_);
+      p += n;
+      bytes -= n;
+    }
+  }
+
+  void Close() {
+    const int fd = fd_;
+    fd_ = -1;
+    if (::close(fd) != 0) throw std::runtime_error("cannot write " + path_);
+  }
+
+ private:
+  std::string path_;
+  int fd_;
+};
+
+// A run of whole lines and what the first pass learned about it.
+struct Chunk {
+  const char* begin;
+  const char* end;
+  long lines = 0;    // physical lines
+  long entries = 0;  // lines carrying data
+  long first = 0;    // entries in the chunks before this one
+  long error_line = -1;  // line of the chunk the error was found on
+  const char* error = nullptr;
+};
+
+// Splits text into about one chunk per worker, every chunk ending just
+// after a newline (or at the end of the text).
+std::vector<Chunk> SplitLines(std::string_view text) {
+  const int workers = S21ThreadPool::Instance().Workers();
+  const std::size_t parts =
+      std::max<std::size_t>(1, std::min<std::size_t>(
+                                   workers, text.size() / kMinChunk));
+  std::vector<Chunk> chunks;
+  const char* p = text.data();
+  const char* end = text.data() + text.size();
+  for (std::size_t c = 1; c <= parts && p < end; ++c) {
+    const char* q = text.data() + text.size() * c / parts;
+    if (q < p) q = p;
+    if (c < parts) {
+      const void* nl = std::memchr(q, '\n', end - q);
+      q = nl ? static_cast<const char*>(nl) + 1 : end;
+    }
+    chunks.push_back(Chunk{p, q});
+    p = q;
+  }
+  return chunks;
+}
+
+const char* LineEnd(const char* p, const char* end) {
+  const void* nl = std::memchr(p, '\n', end - p);
+  return nl ? static_cast<const char*>(nl) : end;
+}
+
+const char* SkipBlanks(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+  return p;
+}
+
+// Parses one number surrounded by optional blanks; nullptr on failure.
+const char* ParseNumber(const char* p, const char* end, double* out) {
+  p = SkipBlanks(p, end);
+  if (p < end && *p == '+') ++p;
+  const std::from_chars_result r = std::from_chars(p, end, *out);
+  if (r.ec != std::errc() || r.ptr == p) return nullptr;
+  return SkipBlanks(r.ptr, end);
+}
+
+// Runs fn(chunk) for every chunk on the pool.
+template <class F>
+void ForEachChunk(std::vector<Chunk>& chunks, F&& fn) {
+  const long bytes = chunks.empty() ? 0 : chunks[0].end - chunks[0].begin;
+  S21ThreadPool::Instance().ParallelFor(
+      0, static_cast<int>(chunks.size()), bytes, [&](int lo, int hi) {
+        for (int c = lo; c < hi; ++c) fn(chunks[c]);
+      });
+}
+
+// First pass: counts lines and data lines (is_data decides) per chunk and
+// numbers the entries across chunks.
+template <class IsData>
+long CountEntries(std::vector<Chunk>& chunks, IsData is_data) {
+  ForEachChunk(chunks, [&](Chunk& c) {
+    for (const char* p = c.begin; p < c.end;) {
+      const char* eol = LineEnd(p, c.end);
+      ++c.lines;
+      if (is_data(p, eol)) ++c.entries;
+      p = eol + 1;
+    }
+  });
+  long total = 0;
+  for (Chunk& c : chunks) {
+    c.first = total;
+    total += c.entries;
+  }
+  return total;
+}
+
+// Rethrows the first error recorded by the second pass; first_line is the
+// file line of the start of the first chunk.
+void ThrowFirstError(const std::vector<Chunk>& chunks, const char* where,
+                     long first_line) {
+  for (const Chunk& c : chunks) {
+    if (c.error != nullptr) {
+      throw std::invalid_argument(std::string(where) + ": line " +
+                                  std::to_string(first_line + c.error_line) +
+                                  ": " + c.error);
+    }
+    first_line += c.lines;
+  }
+}
+
+bool IsBlank(const char* p, const char* eol) {
+  return SkipBlanks(p, eol) == eol;
+}
+
+void AppendNumber(std::string& out, const double value) {
+  char buf[kMaxNumber + 8];
+  const std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), value);
+  out.append(buf, r.ptr);
+}
+
+// Formats units [0, count) in batches of about kBatchBytes; inside a batch
+// every worker formats a contiguous slice into its own buffer with
+// format(unit, out), and the buffers go to sink in order.
+template <class Format, class Sink>
+void FormatUnits(const int count, const long values_per_unit, Format format,
+                 Sink& sink) {
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  const long unit_bytes = values_per_unit * (kMaxNumber + 1);
+  const int batch = static_cast<int>(std::max<long>(
+      1, std::min<long>(count, kBatchBytes / std::max(1L, unit_bytes))));
+  const int parts = std::max(1, std::min(pool.Workers(), batch));
+  std::vector<std::string> bufs(parts);
+  for (int lo = 0; lo < count; lo += batch) {
+    const int hi = std::min(count, lo + batch);
+    pool.ParallelFor(0, parts, (hi - lo) * unit_bytes / parts,
+                     [&](int p0, int p1) {
+                       for (int p = p0; p < p1; ++p) {
+                         std::string& out = bufs[p];
+                         out.clear();
+                         const int u0 = lo + long(hi - lo) * p / parts;
+                         const int u1 = lo + long(hi - lo) * (p + 1) / parts;
+                         out.reserve((u1 - u0) * unit_bytes);
+                         for (int u = u0; u < u1; ++u) format(u, out);
+                       }
+                     });
+    for (const std::string& out : bufs) sink(out);
+  }
+}
+
+template <class Sink>
+void WriteCsv(const S21Matrix& m, const char sep, Sink& sink) {
+  const int cols = m.get_Col();
+  FormatUnits(
+      m.get_Row(), cols,
+      [&](int i, std::string& out) {
+        const double* row = m.data(i);
+        for (int j = 0; j < cols; ++j) {
+          if (j > 0) out.push_back(sep);
+          AppendNumber(out, row[j]);
+        }
+        out.push_back('\n');
+      },
+      sink);
+}
+
+template <class Sink>
+void WriteMatrixMarket(const S21Matrix& m, Sink& sink) {
+  const int rows = m.get_Row();
+  sink("%%MatrixMarket matrix array real general\n" + std::to_string(rows) +
+       " " + std::to_string(m.get_Col()) + "\n");
+  // array entries are listed column by column
+  FormatUnits(
+      m.get_Col(), rows,
+      [&](int j, std::string& out) {
+        for (int i = 0; i < rows; ++i) {
+          AppendNumber(out, m.at_unchecked(i, j));
+          out.push_back('\n');
+        }
+      },
+      sink);
+}
+
+struct MatrixMarketHeader {
+  bool coordinate = false;
+  bool pattern = false;
+  enum { kGeneral, kSymmetric, kSkew } symmetry = kGeneral;
+  long rows = 0, cols = 0, entries = 0;
+  long lines = 0;  // header, comment and size lines
+};
+
+std::string Lower(std::string_view s) {
+  std::string res(s);
+  for (char& ch : res) {
+    if (ch >= 'A' && ch <= 'Z') ch = ch - 'A' + 'a';
+  }
+  return res;
+}
+
+// Splits a line into blank-separated words.
+std::vector<std::string_view> Words(const char* p, const char* eol) {
+  std::vector<std::string_view> words;
+  while ((p = SkipBlanks(p, eol)) < eol) {
+    const char* q = p;
+    while (q < eol && *q != ' ' && *q != '\t' && *q != '\r') ++q;
+    words.emplace_back(p, q - p);
+    p = q;
+  }
+  return words;
+}
+
+// Reads the banner, comments and size line; returns the start of the body.
+const char* ReadHeader(std::string_view text, MatrixMarketHeader& h) {
+  const char* p = text.data();
+  const char* end = p + text.size();
+  const char* eol = LineEnd(p, end);
+  const std::vector<std::string_view> banner = Words(p, eol);
+  if (banner.size() != 5 || banner[0] != "%%MatrixMarket" ||
+      Lower(banner[1]) != "matrix") {
+    throw std::invalid_argument("ParseMatrixMarket: missing banner");
+  }
+  const std::string format = Lower(banner[2]);
+  const std::string field = Lower(banner[3]);
+  const std::string symmetry = Lower(banner[4]);
+  if (format != "array" && format != "coordinate") {
+    throw std::invalid_argument("ParseMatrixMarket: unknown format " + format);
+  }
+  if (field != "real" && field != "integer" && field != "double" &&
+      field != "pattern") {
+    throw std::invalid_argument("ParseMatrixMarket: unsupported field " +
+                                field);
+  }
+  h.coordinate = format == "coordinate";
+  h.pattern = field == "pattern";
+  if (h.pattern && !h.coordinate) {
+    throw std::invalid_argument("ParseMatrixMarket: pattern array matrix");
+  }
+  if (symmetry == "symmetric") {
+    h.symmetry = MatrixMarketHeader::kSymmetric;
+  } else if (symmetry == "skew-symmetric") {
+    h.symmetry = MatrixMarketHeader::kSkew;
+  } else if (symmetry != "general") {
+    throw std::invalid_argument("ParseMatrixMarket: unsupported symmetry " +
+                                symmetry);
+  }
+  h.lines = 1;
+  for (p = eol + 1; p < end; p = eol + 1) {
+    eol = LineEnd(p, end);
+    ++h.lines;
+    if (IsBlank(p, eol) || *SkipBlanks(p, eol) == '%') continue;
+    const std::vector<std::string_view> size = Words(p, eol);
+    long values[3] = {0, 0, 0};
+    const std::size_t expected = h.coordinate ? 3 : 2;
+    bool ok = size.size() == expected;
+    for (std::size_t k = 0; ok && k < expected; ++k) {
+      const char* last = size[k].data() + size[k].size();
+      const std::from_chars_result r =
+          std::from_chars(size[k].data(), last, values[k]);
+      ok = r.ec == std::errc() && r.ptr == last && values[k] >= 0;
+    }
+    if (!ok || values[0] < 1 || values[1] < 1 ||
+        values[0] > std::numeric_limits<int>::max() ||
+        values[1] > std::numeric_limits<int>::max() ||
+        (h.symmetry != MatrixMarketHeader::kGeneral &&
+         values[0] != values[1])) {
+      throw std::invalid_argument("ParseMatrixMarket: line " +
+                                  std::to_string(h.lines) + ": bad size");
+    }
+    h.rows = values[0];
+    h.cols = values[1];
+    if (h.coordinate) {
+      h.entries = values[2];
+    } else if (h.symmetry == MatrixMarketHeader::kGeneral) {
+      h.entries = h.rows * h.cols;
+    } else if (h.symmetry == MatrixMarketHeader::kSymmetric) {
+      h.entries = h.rows * (h.rows + 1) / 2;
+    } else {
+      h.entries = h.rows * (h.rows - 1) / 2;
+    }
+    return std::min(eol + 1, end);
+  }
+  throw std::invalid_argument("ParseMatrixMarket: missing size line");
+}
+
+// Row and column of array entry k: column-major, and for symmetric and
+// skew-symmetric matrices restricted to the lower triangle (strictly lower
+// for skew). Column c of the triangle starts at entry c * m - c * (c - 1) / 2
+// with m = rows - skip; the root of that quadratic gives the column up to
+// rounding, which the loops correct.
+void ArrayPosition(const MatrixMarketHeader& h, long k, long* i, long* j) {
+  if (h.symmetry == MatrixMarketHeader::kGeneral) {
+    *i = k % h.rows;
+    *j = k / h.rows;
+    return;
+  }
+  const long skip = h.symmetry == MatrixMarketHeader::kSkew ? 1 : 0;
+  const long m = h.rows - skip;
+  auto start = [m](const long c) { return c * m - c * (c - 1) / 2; };
+  const double b = m + 0.5;
+  long col = static_cast<long>(b - std::sqrt(std::max(0.0, b * b - 2.0 * k)));
+  col = std::max(0L, std::min(col, m - 1));
+  while (col > 0 && start(col) > k) --col;
+  while (col + 1 < m && start(col + 1) <= k) ++col;
+  *i = col + skip + (k - start(col));
+  *j = col;
+}
+
+// Moves (i, j) to the next array entry in the order of ArrayPosition.
+void NextArrayPosition(const MatrixMarketHeader& h, long* i, long* j) {
+  if (++*i < h.rows) return;
+  ++*j;
+  *i = h.symmetry == MatrixMarketHeader::kGeneral ? 0
+       : h.symmetry == MatrixMarketHeader::kSkew  ? *j + 1
+                                                  : *j;
+}
+
+}  // namespace
+
+S21Matrix S21MatrixIO::FromCsv(const std::string& path, const char sep) {
+  MappedFile file(path);
+  return ParseCsv(file.Text(), sep);
+}
+
+S21Matrix S21MatrixIO::ParseCsv(std::string_view text, const char sep) {
+  std::vector<Chunk> chunks = SplitLines(text);
+  const long rows = CountEntries(chunks, [](const char* p, const char* eol) {
+    return !IsBlank(p, eol);
+  });
+  if (rows == 0) {
+    throw std::invalid_argument("ParseCsv: no data");
+  }
+  if (rows > std::numeric_limits<int>::max()) {
+    throw std::invalid_argument("ParseCsv: too many rows");
+  }
+  // the first data line decides the number of columns
+  const char* head = text.data();
+  const char* head_end = LineEnd(head, head + text.size());
+  while (IsBlank(head, head_end)) {
+    head = head_end + 1;
+    head_end = LineEnd(head, text.data() + text.size());
+  }
+  // a blank separator matches any run of blanks
+  const bool blank_sep = sep == ' ' || sep == '\t';
+  const int cols = blank_sep ? static_cast<int>(Words(head, head_end).size())
+                             : 1 + static_cast<int>(std::count(
+                                       head, head_end, sep));
+
+  S21Matrix res(static_cast<int>(rows), cols);
+  ForEachChunk(chunks, [&](Chunk& c) {
+    long row = c.first;
+    long line = 0;
+    for (const char* q = c.begin; q < c.end; q = LineEnd(q, c.end) + 1) {
+      const char* eol = LineEnd(q, c.end);
+      ++line;
+      if (IsBlank(q, eol)) continue;
+      double* out = res.data(static_cast<int>(row++));
+      for (int j = 0; j < cols; ++j) {
+        q = ParseNumber(q, eol, &out[j]);
+        if (q == nullptr) {
+          c.error = "not a number";
+        } else if (j + 1 < cols &&
+                   (q == eol || (!blank_sep && *q++ != sep))) {
+          c.error = "too few values";
+        }
+        if (c.error != nullptr) break;
+      }
+      if (c.error == nullptr && q != eol) c.error = "too many values";
+      if (c.error != nullptr) {
+        c.error_line = line;
+        return;
+      }
+    }
+  });
+  ThrowFirstError(chunks, "ParseCsv", 0);
+  return res;
+}
+
+void S21MatrixIO::ToCsv(const S21Matrix& m, const std::string& path,
+                        const char sep) {
+  FileSink sink(path);
+  WriteCsv(m, sep, sink);
+  sink.Close();
+}
+
+std::string S21MatrixIO::FormatCsv(const S21Matrix& m, const char sep) {
+  std::string res;
+  auto sink = [&res](const std::string& text) { res += text; };
+  WriteCsv(m, sep, sink);
+  return res;
+}
+
+S21Matrix S21MatrixIO::FromMatrixMarket(const std::string& path) {
+  MappedFile file(path);
+  return ParseMatrixMarket(file.Text());
+}
+
+S21Matrix S21MatrixIO::ParseMatrixMarket(std::string_view text) {
+  MatrixMarketHeader h;
+  const char* body = ReadHeader(text, h);
+  std::vector<Chunk> chunks =
+      SplitLines(text.substr(body - text.data()));
+  const long entries =
+      CountEntries(chunks, [](const char* p, const char* eol) {
+        p = SkipBlanks(p, eol);
+        return p != eol && *p != '%';
+      });
+  if (entries != h.entries) {
+    throw std::invalid_argument("ParseMatrixMarket: expected " +
+                                std::to_string(h.entries) + " entries, got " +
+                                std::to_string(entries));
+  }
+  S21Matrix res(static_cast<int>(h.rows), static_cast<int>(h.cols));
+  const double mirror = h.symmetry == MatrixMarketHeader::kSkew ? -1 : 1;
+  // one bit per element claimed by the first coordinate entry naming it,
+  // so a duplicate is reported instead of racing with the original
+  std::unique_ptr<std::atomic<std::uint64_t>[]> seen;
+  if (h.coordinate) {
+    seen.reset(new std::atomic<std::uint64_t>[(h.rows * h.cols + 63) / 64]());
+  }
+  ForEachChunk(chunks, [&](Chunk& c) {
+    long i = 0, j = 0;
+    if (!h.coordinate) ArrayPosition(h, c.first, &i, &j);
+    long line = 0;
+    for (const char* q = c.begin; q < c.end; q = LineEnd(q, c.end) + 1) {
+      const char* eol = LineEnd(q, c.end);
+      ++line;
+      const char* first = SkipBlanks(q, eol);
+      if (first == eol || *first == '%') continue;
+      double value = 1;
+      if (h.coordinate) {
+        double at[2] = {0, 0};
+        for (int n = 0; n < 2 && q != nullptr; ++n) {
+          q = ParseNumber(q, eol, &at[n]);
+        }
+        // range first, written to reject nan: converting an out of range
+        // double to long is undefined
+        if (q == nullptr || !(at[0] >= 1 && at[0] <= h.rows) ||
+            !(at[1] >= 1 && at[1] <= h.cols) || std::trunc(at[0]) != at[0] ||
+            std::trunc(at[1]) != at[1]) {
+          c.error = "bad index";
+        } else {
+          i = long(at[0]) - 1;
+          j = long(at[1]) - 1;
+        }
+      }
+      if (c.error == nullptr && !h.pattern) {
+        q = ParseNumber(q, eol, &value);
+        if (q == nullptr) c.error = "not a number";
+      }
+      if (c.error == nullptr && q != eol) c.error = "too many values";
+      if (c.error == nullptr && h.symmetry == MatrixMarketHeader::kSkew &&
+          i == j) {
+        c.error = "diagonal entry of a skew-symmetric matrix";
+      }
+      if (c.error == nullptr && h.symmetry != MatrixMarketHeader::kGeneral &&
+          i < j) {
+        c.error = "entry above the diagonal";
+      }
+      if (c.error == nullptr && h.coordinate) {
+        const long bit = i * h.cols + j;
+        const std::uint64_t mask = std::uint64_t(1) << (bit % 64);
+        if (seen[bit / 64].fetch_or(mask, std::memory_order_relaxed) & mask) {
+          c.error = "duplicate entry";
+        }
+      }
+      if (c.error != nullptr) {
+        c.error_line = line;
+        return;
+      }
+      res.at_unchecked(i, j) = value;
+      if (h.symmetry != MatrixMarketHeader::kGeneral) {
+        res.at_unchecked(j, i) = mirror * value;
+      }
+      if (!h.coordinate) NextArrayPosition(h, &i, &j);
+    }
+  });
+  ThrowFirstError(chunks, "ParseMatrixMarket", h.lines);
+  return res;
+}
+
+void S21MatrixIO::ToMatrixMarket(const S21Matrix& m, const std::string& path) {
+  FileSink sink(path);
+  WriteMatrixMarket(m, sink);
+  sink.Close();
+}
+
+std::string S21MatrixIO::FormatMatrixMarket(const S21Matrix& m) {
+  std::string res;
+  auto sink = [&res](const std::string& text) { res += text; };
+  WriteMatrixMarket(m, sink);
+  return res;
+}
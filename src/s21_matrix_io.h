@@ -0,0 +1,36 @@
+#ifndef __S21_MATRIX_IO_H__
+#define __S21_MATRIX_IO_H__
+
+#include <string>
+#include <string_view>
+
+#include "s21_matrix_oop.h"
+
+// Text import/export. Files are memory-mapped and split into chunks on line
+// boundaries that are parsed in parallel straight into the matrix storage.
+// Numbers are written as the shortest decimal that reads back to the same
+// double, so Format* followed by Parse* reproduces the matrix exactly.
+// Malformed input throws std::invalid_argument naming the line, I/O errors
+// throw std::runtime_error.
+class S21MatrixIO {
+ public:
+  // one row per line; blank lines are skipped, '\r' before '\n' is ignored
+  // and a blank separator (' ' or '\t') matches any run of blanks
+  static S21Matrix FromCsv(const std::string& path, const char sep = ',');
+  static S21Matrix ParseCsv(std::string_view text, const char sep = ',');
+  static void ToCsv(const S21Matrix& m, const std::string& path,
+                    const char sep = ',');
+  static std::string FormatCsv(const S21Matrix& m, const char sep = ',');
+
+  // "array" and "coordinate" formats of real, integer or pattern matrices
+  // with general, symmetric or skew-symmetric symmetry; writes "array real
+  // general". Symmetric files hold the lower triangle, skew-symmetric ones
+  // the strictly lower triangle; coordinate entries outside it and entries
+  // listed twice are malformed.
+  static S21Matrix FromMatrixMarket(const std::string& path);
+  static S21Matrix ParseMatrixMarket(std::string_view text);
+  static void ToMatrixMarket(const S21Matrix& m, const std::string& path);
+  static std::string FormatMatrixMarket(const S21Matrix& m);
+};
+
+#endif
@@ -0,0 +1,387 @@
+#include "s21_matrix_lowrank.h"
+
+#include <atomic>
+#include <numeric>
+#include <random>
+#include <string>
+
+#include "s21_matrix_struct.h"
+#include "s21_parallel.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+// Jacobi rotations stop once every pair of rows is this close to orthogonal
+constexpr double kJacobiTol = 1e-15;
+constexpr int kMaxSweeps = 60;
+// columns whose residual drops below this share of their norm are dependent
+constexpr double kDependentTol = 1e-12;
+
+std::uint64_t SplitMix(std::uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+// uniform in (0, 1]
+double Uniform(const std::uint64_t bits) {
+  return ((bits >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+// standard normal entry (i, j) of the sketch seeded by seed, independent of
+// the order the entries are generated in
+double Gaussian(const std::uint64_t seed, const int i, const int j) {
+  const std::uint64_t h =
+      SplitMix(seed ^ SplitMix(std::uint64_t(i) << 32 | std::uint32_t(j)));
+  return std::sqrt(-2 * std::log(Uniform(h))) *
+         std::cos(2 * kPi * Uniform(SplitMix(h)));
+}
+
+// in-place unnormalized Walsh-Hadamard transform, n a power of two
+void Fwht(double* x, const int n) {
+  for (int h = 1; h < n; h <<= 1) {
+    for (int i = 0; i < n; i += 2 * h) {
+      for (int j = i; j < i + h; ++j) {
+        const double a = x[j];
+        const double b = x[j + h];
+        x[j] = a + b;
+        x[j + h] = a - b;
+      }
+    }
+  }
+}
+
+double Dot(const double* x, const double* y, const int n) {
+  double sum = 0;
+  for (int i = 0; i < n; ++i) sum += x[i] * y[i];
+  return sum;
+}
+
+S21Matrix Transposed(const S21Matrix& a) {
+  S21Matrix res(a.get_Col(), a.get_Row());
+  a.TransposeInto(res);
+  return res;
+}
+
+S21Matrix Mul(const S21Matrix& a, const S21Matrix& b) {
+  S21Matrix res(a.get_Row(), b.get_Col());
+  S21Matrix::MulInto(a, b, res);
+  return res;
+}
+
+// top left rows x cols corner
+S21Matrix Block(const S21Matrix& a, const int rows, const int cols) {
+  S21Matrix res(rows, cols);
+  for (int i = 0; i < rows; ++i) {
+    std::copy(a.data(i), a.data(i) + cols, res.data(i));
+  }
+  return res;
+}
+
+// Classical Gram-Schmidt applied twice ("twice is enough") to the rows of
+// q. Rows that depend on the previous ones are zeroed.
+void OrthonormalizeRows(S21Matrix& q) {
+  const int l = q.get_Row();
+  const int m = q.get_Col();
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  std::vector<double> coef(l);
+  for (int j = 0; j < l; ++j) {
+    double* qj = q.data(j);
+    const double norm0 = std::sqrt(Dot(qj, qj, m));
+    for (int pass = 0; pass < 2 && j > 0; ++pass) {
+      pool.ParallelFor(0, j, m, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) coef[i] = Dot(q.data(i), qj, m);
+      });
+      pool.ParallelFor(0, m, j, [&](int lo, int hi) {
+        for (int i = 0; i < j; ++i) {
+          const double* qi = q.data(i);
+          for (int c = lo; c < hi; ++c) qj[c] -= coef[i] * qi[c];
+        }
+      });
+    }
+    const double norm = std::sqrt(Dot(qj, qj, m));
+    const double scale = norm > kDependentTol * norm0 ? 1 / norm : 0;
+    for (int c = 0; c < m; ++c) qj[c] *= scale;
+  }
+}
+
+// One-sided Jacobi: rotates pairs of rows of b until all of them are
+// orthogonal, applying the same rotations to the rows of j. Pairs follow
+// a round-robin tournament, so every round rotates disjoint pairs in
+// parallel.
+void JacobiRows(S21Matrix& b, S21Matrix& j) {
+  const int k = b.get_Row();
+  const int n = b.get_Col();
+  const int players = k + (k & 1);  // k stands for a bye when k is odd
+  std::vector<int> order(players);
+  std::iota(order.begin(), order.end(), 0);
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  for (int sweep = 0; sweep < kMaxSweeps; ++sweep) {
+    std::atomic<bool> rotated(false);
+    for (int round = 0; round + 1 < players; ++round) {
+      pool.ParallelFor(0, players / 2, 3L * (n + k), [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+          int p = order[i];
+          int q = order[players - 1 - i];
+          if (p >= k || q >= k) continue;
+          if (p > q) std::swap(p, q);
+          double* bp = b.data(p);
+          double* bq = b.data(q);
+          const double alpha = Dot(bp, bp, n);
+          const double beta = Dot(bq, bq, n);
+          const double gamma = Dot(bp, bq, n);
+          if (std::fabs(gamma) <= kJacobiTol * std::sqrt(alpha * beta)) {
+            continue;
+          }
+          const double zeta = (beta - alpha) / (2 * gamma);
+          const double t = (zeta >= 0 ? 1 : -1) /
+                           (std::fabs(zeta) + std::sqrt(1 + zeta * zeta));
+          const double c = 1 / std::sqrt(1 + t * t);
+          const double s = c * t;
+          for (int x = 0; x < n; ++x) {
+            const double vp = bp[x];
+            bp[x] = c * vp - s * bq[x];
+            bq[x] = s * vp + c * bq[x];
+          }
+          double* jp = j.data(p);
+          double* jq = j.data(q);
+          for (int x = 0; x < k; ++x) {
+            const double vp = jp[x];
+            jp[x] = c * vp - s * jq[x];
+            jq[x] = s * vp + c * jq[x];
+          }
+          rotated.store(true, std::memory_order_relaxed);
+        }
+      });
+      std::rotate(order.begin() + 1, order.end() - 1, order.end());
+    }
+    if (!rotated) break;
+  }
+}
+
+// SVD of a k x n matrix: b = u * diag(s) * vt with u k x k
+S21LowRank::Svd RowsSvd(S21Matrix b) {
+  const int k = b.get_Row();
+  const int n = b.get_Col();
+  S21Matrix j(k, k);
+  for (int i = 0; i < k; ++i) j(i, i) = 1;
+  JacobiRows(b, j);
+  // j * b_in has orthogonal rows, so b_in = j^T * diag(s) * vt
+  std::vector<double> norms(k);
+  for (int i = 0; i < k; ++i) {
+    norms[i] = std::sqrt(Dot(b.data(i), b.data(i), n));
+  }
+  std::vector<int> order(k);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](int x, int y) { return norms[x] > norms[y]; });
+  S21LowRank::Svd res{S21Matrix(k, k), std::vector<double>(k),
+                      S21Matrix(k, n)};
+  for (int t = 0; t < k; ++t) {
+    const int r = order[t];
+    res.s[t] = norms[r];
+    const double inv = norms[r] > 0 ? 1 / norms[r] : 0;
+    for (int x = 0; x < n; ++x) res.vt(t, x) = b(r, x) * inv;
+    for (int x = 0; x < k; ++x) res.u(x, t) = j(r, x);
+  }
+  return res;
+}
+
+void CheckOptions(const S21LowRankOptions& options, const char* where) {
+  if (options.rank < 1 || options.oversampling < 0 ||
+      options.power_iterations < 0) {
+    throw std::invalid_argument(std::string(where) + ": invalid options");
+  }
+}
+
+int SketchSize(const S21Matrix& a, const S21LowRankOptions& options) {
+  return std::min(options.rank + options.oversampling,
+                  std::min(a.get_Row(), a.get_Col()));
+}
+
+// orthonormal basis of the sketched range of a, as the rows of an l x m
+// matrix; power iterations alternate between the column and the row space
+S21Matrix RangeRows(const S21Matrix& a, const S21LowRankOptions& options) {
+  const int l = SketchSize(a, options);
+  S21Matrix qt =
+      Transposed(S21Sketch::Range(a, l, options.sketch, options.seed));
+  OrthonormalizeRows(qt);
+  if (options.power_iterations > 0) {
+    const S21Matrix at = Transposed(a);
+    for (int it = 0; it < options.power_iterations; ++it) {
+      S21Matrix z = Mul(qt, a);  // (a^T q)^T
+      OrthonormalizeRows(z);
+      qt = Mul(z, at);  // (a z^T)^T
+      OrthonormalizeRows(qt);
+    }
+  }
+  return qt;
+}
+
+}  // namespace
+
+S21Matrix S21Sketch::Range(const S21Matrix& a, const int l, const Kind kind,
+                           const std::uint64_t seed) {
+  const int m = a.get_Row();
+  const int n = a.get_Col();
+  if (l < 1) {
+    throw std::invalid_argument("Range: invalid sketch size");
+  }
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  if (kind == Kind::kGaussian) {
+    S21Matrix omega(n, l);
+    pool.ParallelFor(0, n, 40L * l, [&](int lo, int hi) {
+      for (int i = lo; i < hi; ++i) {
+        double* row = omega.data(i);
+        for (int j = 0; j < l; ++j) row[j] = Gaussian(seed, i, j);
+      }
+    });
+    return Mul(a, omega);
+  }
+  // omega = D * H * R / sqrt(l): random signs, a Hadamard transform over n
+  // padded to a power of two, then l sampled coordinates
+  int padded = 1;
+  int log2 = 0;
+  while (padded < n) {
+    padded <<= 1;
+    ++log2;
+  }
+  if (l > padded) {
+    throw std::invalid_argument("Range: invalid sketch size");
+  }
+  std::vector<int> samples(padded);
+  std::iota(samples.begin(), samples.end(), 0);
+  std::mt19937_64 gen(seed);
+  for (int t = 0; t < l; ++t) {
+    std::uniform_int_distribution<int> pick(t, padded - 1);
+    std::swap(samples[t], samples[pick(gen)]);
+  }
+  std::vector<double> signs(n);
+  for (int j = 0; j < n; ++j) {
+    signs[j] = SplitMix(seed ^ ~std::uint64_t(j)) & 1 ? 1 : -1;
+  }
+  const double scale = 1 / std::sqrt(double(l));
+  S21Matrix res(m, l);
+  pool.ParallelFor(0, m, long(padded) * (log2 + 1), [&](int lo, int hi) {
+    std::vector<double> x(padded);
+    for (int i = lo; i < hi; ++i) {
+      const double* row = a.data(i);
+      for (int j = 0; j < n; ++j) x[j] = signs[j] * row[j];
+      std::fill(x.begin() + n, x.end(), 0.0);
+      Fwht(x.data(), padded);
+      double* out = res.data(i);
+      for (int t = 0; t < l; ++t) out[t] = x[samples[t]] * scale;
+    }
+  });
+  return res;
+}
+
+S21Matrix S21Sketch::Rows(const S21Matrix& a, const int l, const Kind kind,
+                          const std::uint64_t seed) {
+  return Transposed(Range(Transposed(a), l, kind, seed));
+}
+
+S21Matrix S21LowRank::RangeFinder(const S21Matrix& a,
+                                  const S21LowRankOptions& options) {
+  CheckOptions(options, "RangeFinder");
+  return Transposed(RangeRows(a, options));
+}
+
+S21LowRank::Svd S21LowRank::RandomizedSvd(const S21Matrix& a,
+                                          const S21LowRankOptions& options) {
+  CheckOptions(options, "RandomizedSvd");
+  const S21Matrix qt = RangeRows(a, options);
+  // a ~ q * (q^T a), and the small l x n factor is decomposed exactly
+  Svd small = RowsSvd(Mul(qt, a));
+  const int k = std::min(options.rank, qt.get_Row());
+  const S21Matrix u = Mul(Transposed(qt), small.u);
+  small.s.resize(k);
+  return Svd{Block(u, u.get_Row(), k), small.s,
+             Block(small.vt, k, small.vt.get_Col())};
+}
+
+S21LowRank::Id S21LowRank::InterpolativeDecomposition(
+    const S21Matrix& a, const S21LowRankOptions& options) {
+  CheckOptions(options, "InterpolativeDecomposition");
+  const int n = a.get_Col();
+  const int l = SketchSize(a, options);
+  S21Matrix y = S21Sketch::Rows(a, l, options.sketch, options.seed);
+  if (options.power_iterations > 0) {
+    const S21Matrix at = Transposed(a);
+    for (int it = 0; it < options.power_iterations; ++it) {
+      S21Matrix w = Mul(y, at);  // (a y^T)^T
+      OrthonormalizeRows(w);
+      y = Mul(w, a);
+    }
+  }
+  // column-pivoted Gram-Schmidt on the columns of the sketch, kept as the
+  // rows of yt; r collects the coefficients of every column
+  S21Matrix yt = Transposed(y);
+  const int k = std::min(options.rank, l);
+  S21Matrix r(k, n);
+  std::vector<double> norms(n);
+  for (int c = 0; c < n; ++c) norms[c] = Dot(yt.data(c), yt.data(c), l);
+  const double max0 = *std::max_element(norms.begin(), norms.end());
+  std::vector<double> q(l);
+  Id res{std::vector<int>(), S21Matrix(1, 1)};
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  for (int t = 0; t < k; ++t) {
+    const int p = static_cast<int>(
+        std::max_element(norms.begin(), norms.end()) - norms.begin());
+    if (!(norms[p] > kDependentTol * kDependentTol * max0)) break;
+    const double rtt = std::sqrt(Dot(yt.data(p), yt.data(p), l));
+    for (int x = 0; x < l; ++x) q[x] = yt(p, x) / rtt;
+    pool.ParallelFor(0, n, 3L * l, [&](int lo, int hi) {
+      for (int c = lo; c < hi; ++c) {
+        double* row = yt.data(c);
+        const double coef = Dot(row, q.data(), l);
+        r.at_unchecked(t, c) = coef;
+        for (int x = 0; x < l; ++x) row[x] -= coef * q[x];
+        if (norms[c] >= 0) norms[c] = Dot(row, row, l);
+      }
+    });
+    norms[p] = -1;  // never picked again
+    res.cols.push_back(p);
+  }
+  const int rank = static_cast<int>(res.cols.size());
+  if (rank == 0) {
+    throw std::logic_error("InterpolativeDecomposition: the matrix is zero");
+  }
+  // p = r11^-1 * r with r11 the upper triangle on the chosen columns
+  S21PackedMatrix r11(rank, S21PackedMatrix::Kind::kUpper);
+  for (int s = 0; s < rank; ++s) {
+    for (int u = s; u < rank; ++u) r11.at(s, u) = r(s, res.cols[u]);
+  }
+  res.p = r11.Solve(Block(r, rank, n));
+  for (int s = 0; s < rank; ++s) {
+    for (int u = 0; u < rank; ++u) res.p(s, res.cols[u]) = s == u ? 1 : 0;
+  }
+  return res;
+}
+
+S21LowRank::Svd S21LowRank::ExactSvd(const S21Matrix& a) {
+  if (a.get_Row() <= a.get_Col()) {
+    return RowsSvd(a);
+  }
+  // a^T = u' s vt'  =>  a = vt'^T s u'^T
+  Svd t = RowsSvd(Transposed(a));
+  return Svd{Transposed(t.vt), t.s, Transposed(t.u)};
+}
+
+S21Matrix S21LowRank::Reconstruct(const Svd& svd) {
+  S21Matrix us = svd.u;
+  for (int i = 0; i < us.get_Row(); ++i) {
+    for (int j = 0; j < us.get_Col(); ++j) us(i, j) *= svd.s[j];
+  }
+  return Mul(us, svd.vt);
+}
+
+S21Matrix S21LowRank::Reconstruct(const S21Matrix& a, const Id& id) {
+  const int k = static_cast<int>(id.cols.size());
+  S21Matrix c(a.get_Row(), k);
+  for (int i = 0; i < a.get_Row(); ++i) {
+    for (int t = 0; t < k; ++t) c(i, t) = a(i, id.cols[t]);
+  }
+  return Mul(c, id.p);
+}
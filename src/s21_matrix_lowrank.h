@@ -0,0 +1,66 @@
+#ifndef __S21_MATRIX_LOWRANK_H__
+#define __S21_MATRIX_LOWRANK_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "s21_matrix_oop.h"
+
+// Random projections of a matrix onto a few dimensions. Gaussian sketches
+// cost one GEMM, O(m * n * l); the subsampled randomized Hadamard
+// transform (SRHT) costs O(m * n * log n) whatever l is. Equal seeds give
+// equal sketches.
+class S21Sketch {
+ public:
+  enum class Kind { kGaussian, kSrht };
+
+  // a * omega for a random n x l omega: m x l, spans the range of a
+  static S21Matrix Range(const S21Matrix& a, const int l, const Kind kind,
+                         const std::uint64_t seed);
+  // omega * a for a random l x m omega: l x n, spans the row space of a
+  static S21Matrix Rows(const S21Matrix& a, const int l, const Kind kind,
+                        const std::uint64_t seed);
+};
+
+struct S21LowRankOptions {
+  int rank = 10;
+  int oversampling = 10;      // extra sketch dimensions beyond rank
+  int power_iterations = 2;   // passes over a sharpening a decaying spectrum
+  S21Sketch::Kind sketch = S21Sketch::Kind::kGaussian;
+  std::uint64_t seed = 0;
+};
+
+// Low-rank factorizations by the randomized range finder of Halko,
+// Martinsson and Tropp: a few passes over a, O(m * n * (rank +
+// oversampling)) work, all products on the thread pool.
+class S21LowRank {
+ public:
+  // a ~ u * diag(s) * vt, singular values in decreasing order
+  struct Svd {
+    S21Matrix u;   // m x k, orthonormal columns
+    std::vector<double> s;
+    S21Matrix vt;  // k x n, orthonormal rows
+  };
+  // a ~ a(:, cols) * p; p is the identity on the chosen columns
+  struct Id {
+    std::vector<int> cols;
+    S21Matrix p;  // k x n
+  };
+
+  static Svd RandomizedSvd(const S21Matrix& a,
+                           const S21LowRankOptions& options);
+  static Id InterpolativeDecomposition(const S21Matrix& a,
+                                       const S21LowRankOptions& options);
+  // orthonormal basis of the sketched range: m x (rank + oversampling)
+  static S21Matrix RangeFinder(const S21Matrix& a,
+                               const S21LowRankOptions& options);
+
+  // full thin SVD by one-sided Jacobi, O(min(m, n)^2 * max(m, n)) per
+  // sweep; the exact reference for the randomized versions
+  static Svd ExactSvd(const S21Matrix& a);
+
+  static S21Matrix Reconstruct(const Svd& svd);
+  static S21Matrix Reconstruct(const S21Matrix& a, const Id& id);
+};
+
+#endif
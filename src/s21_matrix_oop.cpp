@@ -1,71 +1,246 @@
 #include "s21_matrix_oop.h"
 
-double** S21Matrix::allocate(const int rows_, const int cols_) {
-  double** matrix = new double*[rows_];
-  if (matrix == nullptr) {
-    throw std::bad_alloc();
+#include <cstdint>
+#include <cstring>
+#include <exception>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include "s21_matrix_tune.h"
+#include "s21_parallel.h"
+
+namespace {
+
+constexpr std::size_t kPageSize = 4096;
+// blocks this large come straight from mmap, so their pages are untouched
+// and land on the node of whichever thread writes them first
+constexpr std::size_t kMapThreshold = std::size_t(1) << 21;
+
+double* AllocateBlock(const std::size_t count) {
+#ifdef __linux__
+  if (count * sizeof(double) >= kMapThreshold) {
+    void* p = mmap(nullptr, count * sizeof(double), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    return static_cast<double*>(p);
   }
-  int x = 0;
-  try {
-    for (int i = 0; i < rows_; ++i) {
-      matrix[i] = new double[cols_];
-      if (matrix[i] == nullptr) {
-        x = i;
-        throw std::bad_alloc();
+#endif
+  return new double[count];
+}
+
+void FreeBlock(double* block, const std::size_t count) noexcept {
+#ifdef __linux__
+  if (count * sizeof(double) >= kMapThreshold) {
+    munmap(block, count * sizeof(double));
+    return;
+  }
+#endif
+  (void)count;
+  delete[] block;
+}
+
+// c[u][j] += a[u][x] * b[x][j] for U consecutive rows u, x in [x0, x1) and
+// j in [j0, j1): one pass over a row of b updates all U rows. The rows of c
+// never overlap a or b, which __restrict tells the vectorizer.
+template <int U>
+void MulRows(double* const* c, double* const* a, double* const* b,
+             const int x0, const int x1, const int j0,
+             const int j1) noexcept {
+  double* __restrict c0 = c[0];
+  double* __restrict c1 = c[U > 1 ? 1 : 0];
+  double* __restrict c2 = c[U > 2 ? 2 : 0];
+  double* __restrict c3 = c[U > 2 ? 3 : 0];
+  for (int x = x0; x < x1; ++x) {
+    const double* __restrict row = b[x];
+    const double k0 = a[0][x];
+    if (U == 1) {
+      for (int j = j0; j < j1; ++j) c0[j] += k0 * row[j];
+    } else if (U == 2) {
+      const double k1 = a[1][x];
+      for (int j = j0; j < j1; ++j) {
+        c0[j] += k0 * row[j];
+        c1[j] += k1 * row[j];
       }
-      for (int j = 0; j < cols_; ++j) {
-        matrix[i][j] = 0;
+    } else {
+      const double k1 = a[1][x], k2 = a[2][x], k3 = a[3][x];
+      for (int j = j0; j < j1; ++j) {
+        c0[j] += k0 * row[j];
+        c1[j] += k1 * row[j];
+        c2[j] += k2 * row[j];
+        c3[j] += k3 * row[j];
       }
     }
+  }
+}
+
+}  // namespace
+
+double** S21Matrix::allocate(const int rows_, const int cols_) {
+  return Allocate(rows_, cols_);
+}
+
+// Row table for row_cap rows and one block of row_cap * ld elements; row i
+// starts at block + i * ld.
+double** S21Matrix::Allocate(const int row_cap, const int ld) const {
+  double** matrix = new double*[row_cap];
+  if (row_cap == 0) {
+    return matrix;
+  }
+  double* block = nullptr;
+  try {
+    block = AllocateBlock(std::size_t(row_cap) * ld);
   } catch (const std::exception& err) {
-    for (int i = 0; i < x; ++i) {
-      if (matrix[i] != nullptr) {
-        delete[] matrix[i];
-      }
-    }
     delete[] matrix;
     throw;
   }
+  for (int i = 0; i < row_cap; ++i) {
+    matrix[i] = block + std::size_t(i) * ld;
+  }
+  Place(block, row_cap, ld);
   return matrix;
 }
 
+// Rows shorter than a cache line stay unpadded; longer ones are rounded up
+// to whole cache lines and kept off 4 KiB strides, which alias in L1.
+int S21Matrix::Padded(const int cols) noexcept {
+  if (cols < 8) {
+    return cols;
+  }
+  int ld = (cols + 7) / 8 * 8;
+  if (ld % 512 == 0) {
+    ld += 8;
+  }
+  return ld;
+}
+
+void S21Matrix::Adopt(double** matrix, const int row_cap,
+                      const int ld) noexcept {
+  destructor(*this);
+  matrix_ = matrix;
+  row_cap_ = row_cap;
+  ld_ = ld;
+}
+
+// Moves the elements into storage of the given capacity.
+void S21Matrix::Relocate(const int row_cap, const int ld) {
+  double** res = Allocate(row_cap, ld);
+  S21ThreadPool::Instance().ParallelFor(0, rows_, cols_, [&](int lo, int hi) {
+    for (int i = lo; i < hi; ++i) {
+      std::copy(matrix_[i], matrix_[i] + cols_, res[i]);
+    }
+  });
+  Adopt(res, row_cap, ld);
+}
+
+// Zero-fills a fresh block; the writing thread decides the NUMA node of
+// every page.
+void S21Matrix::Place(double* block, const int rows,
+                      const int cols) const noexcept {
+  // cols is the leading dimension here, so the row padding is touched too
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  const std::size_t count = std::size_t(rows) * cols;
+  if (placement_ == Placement::kPartitioned) {
+    pool.ParallelFor(0, rows, cols, [=](int lo, int hi) {
+      std::fill(block + std::size_t(lo) * cols, block + std::size_t(hi) * cols,
+                0.0);
+    });
+  } else if (placement_ == Placement::kInterleave && pool.Workers() > 1 &&
+             !S21ThreadPool::InWorker() &&
+             long(count) >= S21ThreadPool::ParallelWork()) {
+    struct Pages {
+      S21ThreadPool* pool;
+      double* begin;
+      double* end;
+    } pages{&pool, block, block + count};
+    pool.Run(pool.Workers(), [](void* ctx, int worker) noexcept {
+      Pages* p = static_cast<Pages*>(ctx);
+      const std::size_t lanes = p->pool->Workers();
+      const std::size_t slot = p->pool->InterleaveSlot(worker);
+      const std::uintptr_t first =
+          reinterpret_cast<std::uintptr_t>(p->begin) / kPageSize;
+      const std::uintptr_t last =
+          (reinterpret_cast<std::uintptr_t>(p->end) - 1) / kPageSize;
+      for (std::uintptr_t page = first + slot; page <= last; page += lanes) {
+        double* lo = std::max(p->begin,
+                              reinterpret_cast<double*>(page * kPageSize));
+        double* hi = std::min(
+            p->end, reinterpret_cast<double*>((page + 1) * kPageSize));
+        std::fill(lo, hi, 0.0);
+      }
+    }, &pages);
+  } else {
+    std::fill(block, block + count, 0.0);
+  }
+}
+
 S21Matrix::S21Matrix() {
   rows_ = 3;
   cols_ = 3;
-  matrix_ = allocate(rows_, cols_);
+  row_cap_ = rows_;
+  ld_ = Padded(cols_);
+  matrix_ = Allocate(row_cap_, ld_);
 }
 
 S21Matrix::S21Matrix(int rows, int cols) : rows_(rows), cols_(cols) {
   if (rows < 1 || cols < 1) {
     throw std::invalid_argument("Invalid argument");
   }
-  matrix_ = allocate(rows_, cols_);
+  row_cap_ = rows_;
+  ld_ = Padded(cols_);
+  matrix_ = Allocate(row_cap_, ld_);
 }
 
-S21Matrix::S21Matrix(const S21Matrix& o) : rows_(o.rows_), cols_(o.cols_) {
-  matrix_ = allocate(rows_, cols_);
-  for (int i = 0; i < rows_; ++i) {
-    for (int j = 0; j < cols_; ++j) {
-      matrix_[i][j] = o.matrix_[i][j];
-    }
+S21Matrix::S21Matrix(int rows, int cols, Placement placement)
+    : rows_(rows), cols_(cols), placement_(placement) {
+  if (rows < 1 || cols < 1) {
+    throw std::invalid_argument("Invalid argument");
   }
+  row_cap_ = rows_;
+  ld_ = Padded(cols_);
+  matrix_ = Allocate(row_cap_, ld_);
+}
+
+S21Matrix::S21Matrix(const S21Matrix& o)
+    : rows_(o.rows_), cols_(o.cols_), placement_(o.placement_) {
+  row_cap_ = rows_;
+  ld_ = Padded(cols_);
+  matrix_ = Allocate(row_cap_, ld_);
+  CopyFrom(o);
 }
 
 S21Matrix::S21Matrix(S21Matrix&& o) {
   rows_ = o.rows_;
   cols_ = o.cols_;
+  row_cap_ = o.row_cap_;
+  ld_ = o.ld_;
   matrix_ = o.matrix_;
+  placement_ = o.placement_;
   o.matrix_ = nullptr;
   o.rows_ = 0;
   o.cols_ = 0;
+  o.row_cap_ = 0;
+  o.ld_ = 0;
 }
 
 void S21Matrix::destructor(S21Matrix& o) {
   if (o.matrix_ == nullptr) return;
-  for (int i = 0; i < o.rows_; ++i) {
-    delete[] o.matrix_[i];
+  if (o.row_cap_ > 0) {
+    FreeBlock(o.matrix_[0], std::size_t(o.row_cap_) * o.ld_);
   }
   delete[] o.matrix_;
+  o.matrix_ = nullptr;
+}
+
+void S21Matrix::CopyFrom(const S21Matrix& o) noexcept {
+  S21ThreadPool::Instance().ParallelFor(0, rows_, cols_, [&](int lo, int hi) {
+    for (int i = lo; i < hi; ++i) {
+      std::copy(o.matrix_[i], o.matrix_[i] + cols_, matrix_[i]);
+    }
+  });
 }
 
 S21Matrix::~S21Matrix() {
@@ -75,12 +250,54 @@ S21Matrix::~S21Matrix() {
 }
 
 bool S21Matrix::EqMatrix(const S21Matrix& other) noexcept {
+  return EqMatrix(other, S21Tolerance());
+}
+
+namespace {
+
+// doubles mapped onto integers that are ordered like the values, so the
+// distance in ulps is a plain subtraction
+std::int64_t OrderedBits(const double x) noexcept {
+  std::int64_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits < 0 ? std::numeric_limits<std::int64_t>::min() - bits : bits;
+}
+
+std::uint64_t Mix(std::uint64_t h, std::uint64_t v) noexcept {
+  h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+  h ^= h >> 31;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  return h ^ (h >> 27);
+}
+
+}  // namespace
+
+// Rows are compared in fixed-size chunks without branches inside a chunk,
+// so the compiler can vectorize them; the first mismatching chunk exits.
+bool S21Matrix::EqMatrix(const S21Matrix& other,
+                         const S21Tolerance& tol) const noexcept {
   if ((rows_ != other.rows_) || (cols_ != other.cols_)) {
     return false;
   }
+  constexpr int kChunk = 8;
+  const bool use_rel = tol.rel > 0, use_ulps = tol.ulps > 0;
   for (int i = 0; i < rows_; ++i) {
-    for (int j = 0; j < cols_; ++j) {
-      if (fabs(matrix_[i][j] - other.matrix_[i][j]) > ESP) {
+    const double* a = matrix_[i];
+    const double* b = other.matrix_[i];
+    for (int j0 = 0; j0 < cols_; j0 += kChunk) {
+      const int j1 = std::min(cols_, j0 + kChunk);
+      bool differs = false;
+      for (int j = j0; j < j1; ++j) {
+        const double d = fabs(a[j] - b[j]);
+        bool bad = d > tol.abs;
+        if (use_rel) bad &= d > tol.rel * std::max(fabs(a[j]), fabs(b[j]));
+        if (use_ulps) {
+          const std::int64_t u = OrderedBits(a[j]) - OrderedBits(b[j]);
+          bad &= (u < 0 ? -u : u) > tol.ulps;
+        }
+        differs |= bad;
+      }
+      if (differs) {
         return false;
       }
     }
@@ -88,16 +305,48 @@ bool S21Matrix::EqMatrix(const S21Matrix& other) noexcept {
   return true;
 }
 
+// Each element is reduced to the key of the tolerance cell it falls in:
+// a grid of 4 * abs near zero, and above that (when rel or ulps is set)
+// the sign, exponent and the mantissa bits the tolerance cannot change.
+std::size_t S21Matrix::Hash(const S21Tolerance& tol) const noexcept {
+  const double cell = 4 * tol.abs;
+  int drop = 0;  // low mantissa bits below the tolerance
+  if (tol.ulps > 0) {
+    drop = std::max(drop, int(std::ceil(std::log2(double(tol.ulps)))) + 2);
+  }
+  if (tol.rel > 0) {
+    drop = std::max(drop, 52 + int(std::ceil(std::log2(tol.rel))) + 2);
+  }
+  drop = std::min(std::max(drop, 0), 63);
+  const bool relative = tol.rel > 0 || tol.ulps > 0;
+  std::uint64_t h = Mix(std::uint64_t(rows_), std::uint64_t(cols_));
+  for (int i = 0; i < rows_; ++i) {
+    for (int j = 0; j < cols_; ++j) {
+      const double x = matrix_[i][j];
+      std::uint64_t key;
+      if (cell > 0 && fabs(x) < (relative ? cell : cell * 1e18)) {
+        key = std::uint64_t(std::llround(x / cell));
+      } else {
+        key = std::uint64_t(OrderedBits(x)) >> drop;
+      }
+      h = Mix(h, key);
+    }
+  }
+  return std::size_t(h);
+}
+
 void S21Matrix::SumMatrix(const S21Matrix& o) {
   if (rows_ != o.rows_ || cols_ != o.cols_) {
     throw std::out_of_range(
         "Incorrect input, matrices should have the same size");
   }
-  for (int i = 0; i < rows_; i++) {
-    for (int j = 0; j < cols_; ++j) {
-      matrix_[i][j] = matrix_[i][j] + o.matrix_[i][j];
+  S21ThreadPool::Instance().ParallelFor(0, rows_, cols_, [&](int lo, int hi) {
+    for (int i = lo; i < hi; i++) {
+      for (int j = 0; j < cols_; ++j) {
+        matrix_[i][j] = matrix_[i][j] + o.matrix_[i][j];
+      }
     }
-  }
+  });
 }
 
 void S21Matrix::SubMatrix(const S21Matrix& o) {
@@ -105,75 +354,43 @@ void S21Matrix::SubMatrix(const S21Matrix& o) {
     throw std::out_of_range(
         "Incorrect input, matrices should have the same size");
   }
-  for (int i = 0; i < rows_; i++) {
-    for (int j = 0; j < cols_; ++j) {
-      matrix_[i][j] = matrix_[i][j] - o.matrix_[i][j];
+  S21ThreadPool::Instance().ParallelFor(0, rows_, cols_, [&](int lo, int hi) {
+    for (int i = lo; i < hi; i++) {
+      for (int j = 0; j < cols_; ++j) {
+        matrix_[i][j] = matrix_[i][j] - o.matrix_[i][j];
+      }
     }
-  }
+  });
 }
 
 void S21Matrix::MulNumber(const double num) noexcept {
-  for (int i = 0; i < rows_; i++) {
-    for (int j = 0; j < cols_; ++j) {
-      matrix_[i][j] = matrix_[i][j] * num;
+  S21ThreadPool::Instance().ParallelFor(0, rows_, cols_, [&](int lo, int hi) {
+    for (int i = lo; i < hi; i++) {
+      for (int j = 0; j < cols_; ++j) {
+        matrix_[i][j] = matrix_[i][j] * num;
+      }
     }
-  }
+  });
 }
 
 void S21Matrix::MulMatrix(const S21Matrix& other) {
   if (cols_ != other.rows_) {
     throw std::invalid_argument("MulMatrix: cannot multiply matrices");
   }
-  double** res = allocate(rows_, other.cols_);
-  for (int i = 0; i < rows_; i++) {
-    for (int j = 0; j < other.cols_; j++) {
-      for (int x = 0; x < rows_; x++) {
-        res[i][j] += matrix_[i][x] * other.matrix_[x][j];
-      }
-    }
-  }
-  destructor(*this);
-  matrix_ = res;
+  S21Matrix res(rows_, other.cols_);
+  MulKernel(*this, other, res);
+  *this = std::move(res);
 }
 
 S21Matrix S21Matrix::Transpose() noexcept {
-  S21Matrix res(rows_, cols_);
-  for (int i = 0; i < rows_; ++i) {
-    for (int j = 0; j < cols_; ++j) {
-      res.matrix_[i][j] = matrix_[j][i];
-    }
-  }
+  S21Matrix res(cols_, rows_);
+  TransposeKernel(res);
   return res;
 }
 
 S21Matrix S21Matrix::Minor(const int i, const int j) {
-  if (rows_ != cols_) {
-    throw std::invalid_argument("Minor: the matrix is ​​not square");
-  }
-  if (i < 0 || i > rows_ - 1) {
-    throw std::invalid_argument("Minor: i argument out of range");
-  }
-  if (j < 0 || j > cols_ - 1) {
-    throw std::invalid_argument("Minor: j argument out of range");
-  }
-  int c = 0;
-  int r = 0;
-  int flag = 0;
-  S21Matrix res(rows_ - 1, cols_ - 1);
-  for (int x = 0; x < rows_; x++) {
-    for (int y = 0; y < cols_; y++) {
-      if (x != i && y != j) {
-        res.matrix_[r][c] = matrix_[x][y];
-        c++;
-        flag = 1;
-      }
-    }
-    if (flag) {
-      r++;
-      flag = 0;
-      c = 0;
-    }
-  }
+  S21Matrix res;
+  MinorInto(i, j, res);
   return res;
 }
 
@@ -238,15 +455,26 @@ S21Matrix& S21Matrix::operator=(const S21Matrix& o) {
   if (this == &o) {
     return *this;
   }
-  destructor(*this);
+  // the current storage is reused whenever the other matrix fits in it
+  if (matrix_ == nullptr || o.rows_ > row_cap_ || o.cols_ > ld_) {
+    Adopt(Allocate(o.rows_, Padded(o.cols_)), o.rows_, Padded(o.cols_));
+  }
   rows_ = o.rows_;
   cols_ = o.cols_;
-  matrix_ = allocate(rows_, cols_);
-  for (int i = 0; i < rows_; ++i) {
-    for (int j = 0; j < cols_; ++j) {
-      matrix_[i][j] = o.matrix_[i][j];
-    }
+  CopyFrom(o);
+  return *this;
+}
+
+S21Matrix& S21Matrix::operator=(S21Matrix&& o) noexcept {
+  if (this == &o) {
+    return *this;
   }
+  std::swap(rows_, o.rows_);
+  std::swap(cols_, o.cols_);
+  std::swap(row_cap_, o.row_cap_);
+  std::swap(ld_, o.ld_);
+  std::swap(matrix_, o.matrix_);
+  std::swap(placement_, o.placement_);
   return *this;
 }
 
@@ -325,43 +553,101 @@ int S21Matrix::get_Row() const { return rows_; }
 
 int S21Matrix::get_Col() const { return cols_; }
 
+S21Matrix::Placement S21Matrix::get_Placement() const { return placement_; }
+
+void S21Matrix::set_Placement(Placement const placement) {
+  if (placement == placement_) {
+    return;
+  }
+  S21Matrix mat(rows_, cols_, placement);
+  mat.CopyFrom(*this);
+  *this = std::move(mat);
+}
+
+// Growing within the capacity only zeroes the new rows; beyond it the
+// capacity at least doubles, so appending rows is amortized O(cols).
 void S21Matrix::set_Row(int const x) {
-  if (x < 0) {
+  if (x < 1) {
     throw std::invalid_argument("set_Row: Invalid argument x");
   }
-  S21Matrix mat(x, cols_);
-  for (int i = 0; i < x; ++i) {
-    for (int j = 0; j < cols_; ++j) {
-      if (i >= rows_)
-        mat.matrix_[i][j] = 0;
-      else
-        mat.matrix_[i][j] = matrix_[i][j];
-    }
+  if (x > row_cap_) {
+    Relocate(std::max(x, 2 * row_cap_), ld_);
   }
-  *this = mat;
+  for (int i = rows_; i < x; ++i) {
+    std::fill(matrix_[i], matrix_[i] + cols_, 0.0);
+  }
+  rows_ = x;
 }
 
+// Columns grow into the row padding first and then into a doubled leading
+// dimension, so rows are only moved O(log cols) times.
 void S21Matrix::set_Col(int const y) {
-  if (y < 0) {
+  if (y < 1) {
     throw std::invalid_argument("set_Row: Invalid argument y");
   }
-  S21Matrix mat(rows_, y);
-  for (int i = 0; i != rows_; ++i) {
-    for (int j = 0; j != y; ++j) {
-      if (j >= cols_)
-        mat.matrix_[i][j] = 0;
-      else
-        mat.matrix_[i][j] = matrix_[i][j];
+  if (y > ld_) {
+    Relocate(row_cap_, Padded(std::max(y, 2 * ld_)));
+  }
+  if (y > cols_) {
+    for (int i = 0; i < rows_; ++i) {
+      std::fill(matrix_[i] + cols_, matrix_[i] + y, 0.0);
     }
   }
-  *this = mat;
+  cols_ = y;
+}
+
+int S21Matrix::get_RowCapacity() const { return row_cap_; }
+
+int S21Matrix::get_ColCapacity() const { return ld_; }
+
+void S21Matrix::reserve(const int rows, const int cols) {
+  if (rows < 0 || cols < 0) {
+    throw std::invalid_argument("reserve: Invalid argument");
+  }
+  if (rows > row_cap_ || cols > ld_) {
+    Relocate(std::max(rows, row_cap_), std::max(Padded(cols), ld_));
+  }
+}
+
+void S21Matrix::shrink_to_fit() {
+  if (row_cap_ != rows_ || ld_ != Padded(cols_)) {
+    Relocate(rows_, Padded(cols_));
+  }
+}
+
+void S21Matrix::AppendRow(const double* values) {
+  set_Row(rows_ + 1);
+  std::copy(values, values + cols_, matrix_[rows_ - 1]);
+}
+
+void S21Matrix::AppendRow(std::initializer_list<double> values) {
+  if (int(values.size()) != cols_) {
+    throw std::invalid_argument("AppendRow: row length does not match");
+  }
+  AppendRow(values.begin());
+}
+
+void S21Matrix::AppendCol(const double* values) {
+  set_Col(cols_ + 1);
+  for (int i = 0; i < rows_; ++i) {
+    matrix_[i][cols_ - 1] = values[i];
+  }
+}
+
+void S21Matrix::AppendCol(std::initializer_list<double> values) {
+  if (int(values.size()) != rows_) {
+    throw std::invalid_argument("AppendCol: column length does not match");
+  }
+  AppendCol(values.begin());
 }
 
 S21Matrix::S21Matrix(
     std::initializer_list<std::initializer_list<double>> init) {
   rows_ = init.size();
   cols_ = rows_ > 0 ? init.begin()->size() : 0;
-  matrix_ = allocate(rows_, cols_);
+  row_cap_ = rows_;
+  ld_ = Padded(cols_);
+  matrix_ = Allocate(row_cap_, ld_);
   int x = 0;
   for (auto i = init.begin(); i != init.end(); ++i) {
     int y = 0;
@@ -371,4 +657,523 @@ S21Matrix::S21Matrix(
     }
     x++;
   }
+}
+
+// Contents are unspecified afterwards; the storage is only replaced when
+// the shape does not fit the capacity.
+void S21Matrix::Reshape(const int rows, const int cols) {
+  if (rows < 1 || cols < 1) {
+    throw std::invalid_argument("Invalid argument");
+  }
+  if (matrix_ == nullptr || rows > row_cap_ || cols > ld_) {
+    Adopt(Allocate(rows, Padded(cols)), rows, Padded(cols));
+  }
+  rows_ = rows;
+  cols_ = cols;
+}
+
+void S21Matrix::MulInto(const S21Matrix& a, const S21Matrix& b,
+                        S21Matrix& out) {
+  MulInto(a, b, out, S21Tuner::ForMul(a.rows_, b.cols_, a.cols_));
+}
+
+void S21Matrix::MulInto(const S21Matrix& a, const S21Matrix& b, S21Matrix& out,
+                        const S21KernelParams& params) {
+  if (a.cols_ != b.rows_) {
+    throw std::invalid_argument("MulInto: cannot multiply matrices");
+  }
+  if (&out == &a || &out == &b) {
+    throw std::invalid_argument("MulInto: out must not alias an operand");
+  }
+  S21Tuner::Validate(params);
+  out.Reshape(a.rows_, b.cols_);
+  MulKernel(a, b, out, params);
+}
+
+void S21Matrix::MulKernel(const S21Matrix& a, const S21Matrix& b,
+                          S21Matrix& out) noexcept {
+  MulKernel(a, b, out, S21Tuner::ForMul(a.rows_, b.cols_, a.cols_));
+}
+
+// Each worker owns a range of result rows and walks b in depth x cols
+// panels, so a panel stays in cache for block_rows rows of the result and
+// every loaded row of b feeds unroll result rows. The x order of the sums
+// is the plain one, so both kernels give bit-identical results.
+void S21Matrix::MulKernel(const S21Matrix& a, const S21Matrix& b,
+                          S21Matrix& out,
+                          const S21KernelParams& params) noexcept {
+  const int depth = a.cols_;
+  const int cols = b.cols_;
+  const long cost = long(depth) * cols;
+  if (std::max(depth, cols) < params.mul_blocked_min) {
+    S21ThreadPool::Instance().ParallelFor(
+        0, a.rows_, cost, [&](int lo, int hi) {
+          for (int i = lo; i < hi; ++i) {
+            double* res = out.matrix_[i];
+            for (int j = 0; j < cols; ++j) {
+              res[j] = 0;
+            }
+            for (int x = 0; x < depth; ++x) {
+              const double k = a.matrix_[i][x];
+              const double* row = b.matrix_[x];
+              for (int j = 0; j < cols; ++j) {
+                res[j] += k * row[j];
+              }
+            }
+          }
+        });
+    return;
+  }
+  S21ThreadPool::Instance().ParallelFor(0, a.rows_, cost, [&](int lo,
+                                                              int hi) {
+    for (int i = lo; i < hi; ++i) {
+      std::fill(out.matrix_[i], out.matrix_[i] + cols, 0.0);
+    }
+    for (int i0 = lo; i0 < hi; i0 += params.mul_block_rows) {
+      const int i1 = std::min(hi, i0 + params.mul_block_rows);
+      for (int j0 = 0; j0 < cols; j0 += params.mul_block_cols) {
+        const int j1 = std::min(cols, j0 + params.mul_block_cols);
+        for (int x0 = 0; x0 < depth; x0 += params.mul_block_depth) {
+          const int x1 = std::min(depth, x0 + params.mul_block_depth);
+          int i = i0;
+          if (params.mul_unroll >= 4) {
+            for (; i + 4 <= i1; i += 4) {
+              MulRows<4>(out.matrix_ + i, a.matrix_ + i, b.matrix_, x0, x1,
+                         j0, j1);
+            }
+          }
+          if (params.mul_unroll >= 2) {
+            for (; i + 2 <= i1; i += 2) {
+              MulRows<2>(out.matrix_ + i, a.matrix_ + i, b.matrix_, x0, x1,
+                         j0, j1);
+            }
+          }
+          for (; i < i1; ++i) {
+            MulRows<1>(out.matrix_ + i, a.matrix_ + i, b.matrix_, x0, x1, j0,
+                       j1);
+          }
+        }
+      }
+    }
+  });
+}
+
+void S21Matrix::TransposeInto(S21Matrix& out) const {
+  TransposeInto(out, S21Tuner::Defaults());
+}
+
+void S21Matrix::TransposeInto(S21Matrix& out,
+                              const S21KernelParams& params) const {
+  if (&out == this) {
+    throw std::invalid_argument("TransposeInto: out must not alias the matrix");
+  }
+  S21Tuner::Validate(params);
+  out.Reshape(cols_, rows_);
+  TransposeKernel(out, params);
+}
+
+void S21Matrix::TransposeKernel(S21Matrix& out) const noexcept {
+  TransposeKernel(out, S21Tuner::Defaults());
+}
+
+void S21Matrix::TransposeKernel(S21Matrix& out,
+                                const S21KernelParams& params) const noexcept {
+  // partitioned by output rows, the rows the workers first-touched in out;
+  // square blocks keep both the rows read and the rows written in cache
+  const int t = params.transpose_block;
+  S21ThreadPool::Instance().ParallelFor(0, cols_, rows_, [&](int lo, int hi) {
+    for (int i0 = 0; i0 < rows_; i0 += t) {
+      const int i1 = std::min(rows_, i0 + t);
+      for (int j0 = lo; j0 < hi; j0 += t) {
+        const int j1 = std::min(hi, j0 + t);
+        for (int j = j0; j < j1; ++j) {
+          double* dst = out.matrix_[j];
+          for (int i = i0; i < i1; ++i) {
+            dst[i] = matrix_[i][j];
+          }
+        }
+      }
+    }
+  });
+}
+
+void S21Matrix::MinorInto(const int i, const int j, S21Matrix& out) const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("Minor: the matrix is ​​not square");
+  }
+  if (i < 0 || i > rows_ - 1) {
+    throw std::invalid_argument("Minor: i argument out of range");
+  }
+  if (j < 0 || j > cols_ - 1) {
+    throw std::invalid_argument("Minor: j argument out of range");
+  }
+  if (&out == this) {
+    throw std::invalid_argument("MinorInto: out must not alias the matrix");
+  }
+  out.Reshape(rows_ - 1, cols_ - 1);
+  MinorKernel(i, j, out);
+}
+
+void S21Matrix::MinorKernel(const int i, const int j,
+                            S21Matrix& out) const noexcept {
+  int r = 0;
+  for (int x = 0; x < rows_; x++) {
+    if (x == i) continue;
+    int c = 0;
+    for (int y = 0; y < cols_; y++) {
+      if (y == j) continue;
+      out.matrix_[r][c] = matrix_[x][y];
+      c++;
+    }
+    r++;
+  }
+}
+
+void S21Matrix::InverseInto(S21Matrix& out, S21Matrix& workspace) const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("InverseInto: the matrix is ​​not square");
+  }
+  if (&out == this || &workspace == this || &out == &workspace) {
+    throw std::invalid_argument("InverseInto: arguments must not alias");
+  }
+  out.Reshape(rows_, cols_);
+  workspace.Reshape(rows_, cols_);
+  if (!InverseKernel(out, workspace)) {
+    throw std::logic_error("InverseInto: the matrix is singular");
+  }
+}
+
+double S21Matrix::DeterminantInto(S21Matrix& workspace) const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("DeterminantInto: the matrix is not square");
+  }
+  if (&workspace == this) {
+    throw std::invalid_argument("DeterminantInto: arguments must not alias");
+  }
+  const int n = rows_;
+  workspace.Reshape(n, n);
+  double** w = workspace.matrix_;
+  for (int i = 0; i < n; ++i) std::copy(matrix_[i], matrix_[i] + n, w[i]);
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  double det = 1;
+  for (int k = 0; k < n; ++k) {
+    int p = k;
+    for (int i = k + 1; i < n; ++i) {
+      if (fabs(w[i][k]) > fabs(w[p][k])) p = i;
+    }
+    if (w[p][k] == 0) return 0;
+    if (p != k) {
+      std::swap_ranges(w[k] + k, w[k] + n, w[p] + k);
+      det = -det;
+    }
+    det *= w[k][k];
+    pool.ParallelFor(k + 1, n, n - k, [&](int lo, int hi) {
+      for (int i = lo; i < hi; ++i) {
+        const double f = w[i][k] / w[k][k];
+        if (f == 0) continue;
+        for (int j = k + 1; j < n; ++j) w[i][j] -= f * w[k][j];
+      }
+    });
+  }
+  return det;
+}
+
+// Gauss-Jordan elimination with partial pivoting on [workspace | out].
+// Rows are swapped in place, so the storage of both matrices keeps its
+// layout and nothing is allocated.
+bool S21Matrix::InverseKernel(S21Matrix& out,
+                              S21Matrix& workspace) const noexcept {
+  const int n = rows_;
+  double scale = 0;
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      workspace.matrix_[i][j] = matrix_[i][j];
+      out.matrix_[i][j] = i == j ? 1 : 0;
+      scale = std::max(scale, fabs(matrix_[i][j]));
+    }
+  }
+  const double eps = scale * n * std::numeric_limits<double>::epsilon();
+  double** w = workspace.matrix_;
+  double** o = out.matrix_;
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  for (int k = 0; k < n; ++k) {
+    int p = k;
+    for (int i = k + 1; i < n; ++i) {
+      if (fabs(w[i][k]) > fabs(w[p][k])) p = i;
+    }
+    if (!(fabs(w[p][k]) > eps)) {
+      return false;
+    }
+    if (p != k) {
+      std::swap_ranges(w[k], w[k] + n, w[p]);
+      std::swap_ranges(o[k], o[k] + n, o[p]);
+    }
+    const double inv = 1.0 / w[k][k];
+    for (int j = 0; j < n; ++j) {
+      w[k][j] *= inv;
+      o[k][j] *= inv;
+    }
+    pool.ParallelFor(0, n, 2 * n, [&](int lo, int hi) {
+      for (int i = lo; i < hi; ++i) {
+        const double f = w[i][k];
+        if (i == k || f == 0) continue;
+        for (int j = 0; j < n; ++j) {
+          w[i][j] -= f * w[k][j];
+          o[i][j] -= f * o[k][j];
+        }
+      }
+    });
+  }
+  return true;
+}
+
+void S21Matrix::PowerInto(const int k, S21Matrix& out, S21Matrix& base,
+                          S21Matrix& scratch) const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("PowerInto: the matrix is not square");
+  }
+  if (&out == this || &base == this || &scratch == this || &out == &base ||
+      &out == &scratch || &base == &scratch) {
+    throw std::invalid_argument("PowerInto: arguments must not alias");
+  }
+  const int n = rows_;
+  out.Reshape(n, n);
+  base.Reshape(n, n);
+  scratch.Reshape(n, n);
+  if (k < 0) {
+    if (!InverseKernel(base, scratch)) {
+      throw std::logic_error("PowerInto: the matrix is singular");
+    }
+  } else {
+    base.CopyFrom(*this);
+  }
+  unsigned long e = k < 0 ? -static_cast<long>(k) : k;
+  if (e == 0) {
+    for (int i = 0; i < n; ++i) {
+      std::fill(out.matrix_[i], out.matrix_[i] + n, 0.0);
+      out.matrix_[i][i] = 1;
+    }
+    return;
+  }
+  // out collects base^(2^i) for the set bits of e; the lowest one is copied
+  // rather than multiplied into an identity
+  bool empty = true;
+  for (;;) {
+    if (e & 1) {
+      if (empty) {
+        out.CopyFrom(base);
+        empty = false;
+      } else {
+        MulKernel(out, base, scratch);
+        std::swap(out, scratch);
+      }
+    }
+    e >>= 1;
+    if (e == 0) break;
+    MulKernel(base, base, scratch);
+    std::swap(base, scratch);
+  }
+}
+
+S21Matrix S21Matrix::Power(const int k) const {
+  S21Matrix out(rows_, cols_);
+  S21Matrix base(rows_, cols_);
+  S21Matrix scratch(rows_, cols_);
+  PowerInto(k, out, base, scratch);
+  return out;
+}
+
+namespace {
+
+// numerator coefficients of the [m/m] Pade approximants of e^x; the
+// denominator has the same ones with alternating signs
+constexpr double kPade3[] = {120, 60, 12, 1};
+constexpr double kPade5[] = {30240, 15120, 3360, 420, 30, 1};
+constexpr double kPade7[] = {17297280, 8648640, 1995840, 277200,
+                             25200,    1512,    56,      1};
+constexpr double kPade9[] = {17643225600, 8821612800, 2075673600, 302702400,
+                             30270240,    2162160,    110880,     3960,
+                             90,          1};
+constexpr double kPade13[] = {64764752532480000, 32382376266240000,
+                              7771770303897600,  1187353796428800,
+                              129060195264000,   10559470521600,
+                              670442572800,      33522128640,
+                              1323241920,        40840800,
+                              960960,            16380,
+                              182,               1};
+// largest 1-norm for which degree 3, 5, 7, 9, 13 is accurate to double
+// precision (Higham 2005, table 2.3)
+constexpr double kPadeTheta[] = {1.495585217958292e-2, 2.539398330063230e-1,
+                                 9.504178996162932e-1, 2.097847961257068e0,
+                                 5.371920351148152e0};
+
+double Norm1(const S21Matrix& m) {
+  std::vector<double> sums(m.get_Col(), 0.0);
+  for (int i = 0; i < m.get_Row(); ++i) {
+    const double* row = m.data(i);
+    for (int j = 0; j < m.get_Col(); ++j) sums[j] += std::fabs(row[j]);
+  }
+  return *std::max_element(sums.begin(), sums.end());
+}
+
+// out = sum of coef * term + diag * I; out may be one of the terms
+void Combine(S21Matrix& out,
+             std::initializer_list<std::pair<double, const S21Matrix*>> terms,
+             const double diag) noexcept {
+  const int n = out.get_Col();
+  const long cost = long(n) * terms.size();
+  S21ThreadPool::Instance().ParallelFor(
+      0, out.get_Row(), cost, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+          double* row = out.data(i);
+          for (int j = 0; j < n; ++j) {
+            double sum = i == j ? diag : 0;
+            for (const auto& t : terms) sum += t.first * t.second->data(i)[j];
+            row[j] = sum;
+          }
+        }
+      });
+}
+
+}  // namespace
+
+S21Matrix S21Matrix::Exp() const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("Exp: the matrix is not square");
+  }
+  const int n = rows_;
+  const double norm = Norm1(*this);
+  if (!std::isfinite(norm)) {
+    throw std::invalid_argument("Exp: the matrix is not finite");
+  }
+  int degree = 13;
+  const double* b = kPade13;
+  const int degrees[] = {3, 5, 7, 9};
+  const double* coefficients[] = {kPade3, kPade5, kPade7, kPade9};
+  for (int d = 0; d < 4; ++d) {
+    if (norm <= kPadeTheta[d]) {
+      degree = degrees[d];
+      b = coefficients[d];
+      break;
+    }
+  }
+  // e^A = (e^(A / 2^s))^(2^s) with A / 2^s inside the degree 13 range
+  S21Matrix a(*this);
+  int squarings = 0;
+  if (degree == 13 && norm > kPadeTheta[4]) {
+    squarings = static_cast<int>(std::ceil(std::log2(norm / kPadeTheta[4])));
+    a.MulNumber(std::ldexp(1.0, -squarings));
+  }
+
+  S21Matrix a2(n, n), u(n, n), v(n, n), tmp(n, n);
+  MulKernel(a, a, a2);
+  if (degree == 13) {
+    S21Matrix a4(n, n), a6(n, n);
+    MulKernel(a2, a2, a4);
+    MulKernel(a4, a2, a6);
+    Combine(tmp, {{b[13], &a6}, {b[11], &a4}, {b[9], &a2}}, 0);
+    MulKernel(a6, tmp, v);
+    Combine(v, {{1, &v}, {b[7], &a6}, {b[5], &a4}, {b[3], &a2}}, b[1]);
+    MulKernel(a, v, u);
+    Combine(tmp, {{b[12], &a6}, {b[10], &a4}, {b[8], &a2}}, 0);
+    MulKernel(a6, tmp, v);
+    Combine(v, {{1, &v}, {b[6], &a6}, {b[4], &a4}, {b[2], &a2}}, b[0]);
+  } else {
+    // even powers A^2 .. A^(degree - 1)
+    std::vector<S21Matrix> powers;
+    powers.push_back(a2);
+    for (int p = 4; p < degree; p += 2) {
+      powers.emplace_back(n, n);
+      MulKernel(powers[powers.size() - 2], a2, powers.back());
+    }
+    Combine(tmp, {}, b[1]);
+    Combine(v, {}, b[0]);
+    for (std::size_t p = 0; p < powers.size(); ++p) {
+      Combine(tmp, {{1, &tmp}, {b[2 * p + 3], &powers[p]}}, 0);
+      Combine(v, {{1, &v}, {b[2 * p + 2], &powers[p]}}, 0);
+    }
+    MulKernel(a, tmp, u);
+  }
+  // r = (V - U)^-1 (V + U)
+  Combine(tmp, {{1, &v}, {-1, &u}}, 0);
+  Combine(v, {{1, &v}, {1, &u}}, 0);
+  if (!SolveKernel(tmp, v)) {
+    throw std::logic_error("Exp: the Pade denominator is singular");
+  }
+  for (int s = 0; s < squarings; ++s) {
+    MulKernel(v, v, tmp);
+    std::swap(v, tmp);
+  }
+  return v;
+}
+
+std::vector<S21Matrix> S21Matrix::ExpBatch(
+    const std::vector<S21Matrix>& batch) {
+  const int count = static_cast<int>(batch.size());
+  std::vector<S21Matrix> res(count);
+  std::vector<std::exception_ptr> errors(count);
+  long cost = 0;
+  for (const S21Matrix& m : batch) cost += 20L * m.rows_ * m.rows_ * m.cols_;
+  // one matrix per task; Exp run by a worker keeps its kernels inline
+  S21ThreadPool::Instance().ParallelFor(
+      0, count, count ? cost / count : 0, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+          try {
+            res[i] = batch[i].Exp();
+          } catch (...) {
+            errors[i] = std::current_exception();
+          }
+        }
+      });
+  for (const std::exception_ptr& e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+  return res;
+}
+
+// Overwrites b with a^-1 b: Gaussian elimination with partial pivoting on
+// [a | b] followed by back substitution. a is destroyed; rows are swapped
+// in place as in InverseKernel.
+bool S21Matrix::SolveKernel(S21Matrix& a, S21Matrix& b) noexcept {
+  const int n = a.rows_;
+  const int m = b.cols_;
+  double scale = 0;
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) scale = std::max(scale, fabs(a.matrix_[i][j]));
+  }
+  const double eps = scale * n * std::numeric_limits<double>::epsilon();
+  double** w = a.matrix_;
+  double** x = b.matrix_;
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  for (int k = 0; k < n; ++k) {
+    int p = k;
+    for (int i = k + 1; i < n; ++i) {
+      if (fabs(w[i][k]) > fabs(w[p][k])) p = i;
+    }
+    if (!(fabs(w[p][k]) > eps)) {
+      return false;
+    }
+    if (p != k) {
+      std::swap_ranges(w[k] + k, w[k] + n, w[p] + k);
+      std::swap_ranges(x[k], x[k] + m, x[p]);
+    }
+    pool.ParallelFor(k + 1, n, n - k + m, [&](int lo, int hi) {
+      for (int i = lo; i < hi; ++i) {
+        const double f = w[i][k] / w[k][k];
+        if (f == 0) continue;
+        for (int j = k + 1; j < n; ++j) w[i][j] -= f * w[k][j];
+        for (int j = 0; j < m; ++j) x[i][j] -= f * x[k][j];
+      }
+    });
+  }
+  pool.ParallelFor(0, m, long(n) * n / 2, [&](int lo, int hi) {
+    for (int i = n - 1; i >= 0; --i) {
+      for (int j = i + 1; j < n; ++j) {
+        const double u = w[i][j];
+        for (int c = lo; c < hi; ++c) x[i][c] -= u * x[j][c];
+      }
+      for (int c = lo; c < hi; ++c) x[i][c] /= w[i][i];
+    }
+  });
+  return true;
 }
\ No newline at end of file
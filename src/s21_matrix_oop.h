@@ -1,18 +1,54 @@
 #ifndef __S21_MATRIX_OOP_H__
 #define __S21_MATRIX_OOP_H__
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <cstddef>
 #include <exception>
+#include <initializer_list>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 #define ESP 10E-7
 
+// Approximate comparison settings: two elements match when they are within
+// abs of each other, within rel of the larger magnitude, or at most ulps
+// representable doubles apart. A zero field disables that criterion.
+struct S21Tolerance {
+  double abs = ESP;
+  double rel = 0;
+  long ulps = 0;
+};
+
+// Block sizes and crossovers of the dense kernels. The built-in values suit
+// a typical 32 KiB L1 / 1 MiB L2 core; S21Tuner replaces them with values
+// measured on the running machine.
+struct S21KernelParams {
+  int mul_block_rows = 64;    // rows of the result kept hot per panel pass
+  int mul_block_depth = 256;  // rows of the right operand in a panel
+  int mul_block_cols = 512;   // columns of the right operand in a panel
+  int mul_unroll = 4;         // result rows sharing a load of b: 1, 2 or 4
+  int mul_blocked_min = 64;   // narrower products use the plain kernel
+  int transpose_block = 32;
+  long parallel_work = 1L << 16;  // see S21ThreadPool::ParallelWork
+};
+
 class S21Matrix {
  public:
+  // NUMA placement of the element storage, applied at first touch:
+  // kLocal - the allocating thread touches everything,
+  // kPartitioned - row blocks are touched by the workers that compute them,
+  // kInterleave - pages are spread round-robin over the NUMA nodes
+  enum class Placement { kLocal, kPartitioned, kInterleave };
+
   // constructors
   S21Matrix();                    // default constructor
   S21Matrix(int rows, int cols);  // parameterized constructor
+  S21Matrix(int rows, int cols, Placement placement);
   S21Matrix(const S21Matrix& o);  // copy cnstructor  конструктор копирования
   S21Matrix(S21Matrix&& o);  // move cnstructor  переместить конструктор
   S21Matrix(std::initializer_list<std::initializer_list<double>> init_list);
@@ -20,6 +56,11 @@ class S21Matrix {
 
   // methods
   bool EqMatrix(const S21Matrix& other) noexcept;
+  bool EqMatrix(const S21Matrix& other,
+                const S21Tolerance& tol) const noexcept;
+  // content hash quantized to tol: matrices that are EqMatrix(tol) usually
+  // hash alike, so a hash lookup must still confirm with EqMatrix
+  std::size_t Hash(const S21Tolerance& tol = S21Tolerance()) const noexcept;
   void SumMatrix(const S21Matrix& other);
   void SubMatrix(const S21Matrix& other);
   void MulNumber(const double num) noexcept;
@@ -29,6 +70,13 @@ class S21Matrix {
   S21Matrix CalcComplements();
   double Determinant();
   S21Matrix InverseMatrix();
+  // A^k by repeated squaring, O(log k) products; k < 0 raises the inverse
+  S21Matrix Power(const int k) const;
+  // e^A by scaling and squaring with a degree 3..13 Pade approximant
+  // (Higham 2005), the denominator solved by LU with partial pivoting
+  S21Matrix Exp() const;
+  // Exp of every matrix, the matrices spread over the thread pool
+  static std::vector<S21Matrix> ExpBatch(const std::vector<S21Matrix>& batch);
 
   // operators
   S21Matrix operator+(const S21Matrix& o);
@@ -38,6 +86,7 @@ class S21Matrix {
   friend S21Matrix operator*(const double& num, const S21Matrix& other);
   bool operator==(const S21Matrix& o) noexcept;
   S21Matrix& operator=(const S21Matrix& o);
+  S21Matrix& operator=(S21Matrix&& o) noexcept;
   S21Matrix& operator+=(const S21Matrix& o);
   S21Matrix& operator-=(const S21Matrix& o);
   S21Matrix& operator*=(const S21Matrix& o);
@@ -50,16 +99,91 @@ class S21Matrix {
   int get_Col() const;
   void set_Row(int const x);
   void set_Col(int const y);
+  Placement get_Placement() const;
+  void set_Placement(Placement const placement);
+
+  // capacity: rows and columns that fit without moving the elements
+  int get_RowCapacity() const;
+  int get_ColCapacity() const;
+  void reserve(const int rows, const int cols);
+  void shrink_to_fit();
+  void AppendRow(const double* values);  // cols values
+  void AppendRow(std::initializer_list<double> values);
+  void AppendCol(const double* values);  // rows values
+  void AppendCol(std::initializer_list<double> values);
+
+  // allocation-free fast path: no range checks (assert only in debug builds),
+  // *Into variants reuse the storage of out/workspace when the shape matches
+  double& at_unchecked(const int row, const int col) noexcept;
+  double at_unchecked(const int row, const int col) const noexcept;
+  double* data(const int row) noexcept;
+  const double* data(const int row) const noexcept;
+  static void MulInto(const S21Matrix& a, const S21Matrix& b, S21Matrix& out);
+  // with explicit kernel parameters instead of the tuned ones
+  static void MulInto(const S21Matrix& a, const S21Matrix& b, S21Matrix& out,
+                      const S21KernelParams& params);
+  void TransposeInto(S21Matrix& out) const;
+  void TransposeInto(S21Matrix& out, const S21KernelParams& params) const;
+  void MinorInto(const int i, const int j, S21Matrix& out) const;
+  void InverseInto(S21Matrix& out, S21Matrix& workspace) const;
+  // LU with partial pivoting in workspace, O(n^3) where Determinant expands
+  // by cofactors
+  double DeterminantInto(S21Matrix& workspace) const;
+  // base and scratch are ping-pong buffers swapped with out as needed
+  void PowerInto(const int k, S21Matrix& out, S21Matrix& base,
+                 S21Matrix& scratch) const;
 
   // other methods
   double** allocate(const int rows_, const int cols_);
   void destructor(S21Matrix& o);
 
  private:
+  static int Padded(const int cols) noexcept;
+  double** Allocate(const int row_cap, const int ld) const;
+  void Adopt(double** matrix, const int row_cap, const int ld) noexcept;
+  void Relocate(const int row_cap, const int ld);
+  void Place(double* block, const int rows, const int cols) const noexcept;
+  void CopyFrom(const S21Matrix& o) noexcept;
+  void Reshape(const int rows, const int cols);
+  static void MulKernel(const S21Matrix& a, const S21Matrix& b,
+                        S21Matrix& out) noexcept;
+  static void MulKernel(const S21Matrix& a, const S21Matrix& b,
+                        S21Matrix& out,
+                        const S21KernelParams& params) noexcept;
+  void TransposeKernel(S21Matrix& out) const noexcept;
+  void TransposeKernel(S21Matrix& out,
+                       const S21KernelParams& params) const noexcept;
+  void MinorKernel(const int i, const int j, S21Matrix& out) const noexcept;
+  bool InverseKernel(S21Matrix& out, S21Matrix& workspace) const noexcept;
+  static bool SolveKernel(S21Matrix& a, S21Matrix& b) noexcept;
+
   // атрибуты
   int rows_, cols_;  // rows and columns attributes  нижнее подчеркивание в
                      // конце / private идет в конце класса
   double** matrix_;  // указатель на память, где будет размещена матрица
+  int row_cap_ = 0, ld_ = 0;  // allocated rows, elements between rows
+  Placement placement_ = Placement::kPartitioned;
 };
 
+inline double& S21Matrix::at_unchecked(const int row, const int col) noexcept {
+  assert(row >= 0 && row < rows_ && col >= 0 && col < cols_);
+  return matrix_[row][col];
+}
+
+inline double S21Matrix::at_unchecked(const int row,
+                                      const int col) const noexcept {
+  assert(row >= 0 && row < rows_ && col >= 0 && col < cols_);
+  return matrix_[row][col];
+}
+
+inline double* S21Matrix::data(const int row) noexcept {
+  assert(row >= 0 && row < rows_);
+  return matrix_[row];
+}
+
+inline const double* S21Matrix::data(const int row) const noexcept {
+  assert(row >= 0 && row < rows_);
+  return matrix_[row];
+}
+
 #endif
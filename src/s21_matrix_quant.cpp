@@ -0,0 +1,323 @@
+#include "s21_matrix_quant.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "s21_parallel.h"
+
+namespace {
+
+// Columns of the compressed right operand decoded at a time: 2 KiB of
+// doubles, resident in L1 while the rows of the result stream past.
+constexpr int kPanel = 256;
+// Rows of the result that share one decoded panel.
+constexpr int kRowBlock = 64;
+
+// Nearest-even encoding of v in a binary format with E exponent and M
+// mantissa bits, sign in bit 15. |v| must be below Overflow<E, M>().
+template <int E, int M>
+std::uint16_t Encode(const double v) {
+  constexpr int kBias = (1 << (E - 1)) - 1;
+  constexpr int kMinExp = 1 - kBias;  // exponent of the smallest normal
+  const double a = std::fabs(v);
+  std::uint16_t bits;
+  if (a < std::ldexp(1.0, kMinExp)) {
+    // subnormal: a multiple of 2^(kMinExp - M); rounding up to 2^M units
+    // gives exactly the smallest normal
+    bits = static_cast<std::uint16_t>(
+        std::nearbyint(std::ldexp(a, M - kMinExp)));
+  } else {
+    int e;
+    std::frexp(a, &e);  // a in [2^(e-1), 2^e)
+    // q in [2^M, 2^(M+1)]; q == 2^(M+1) carries into the exponent
+    const double q = std::nearbyint(std::ldexp(a, M + 1 - e));
+    bits = static_cast<std::uint16_t>(((e - 2 + kBias) << M) + int(q));
+  }
+  return std::signbit(v) ? bits | 0x8000 : bits;
+}
+
+// smallest magnitude that rounds to infinity
+template <int E, int M>
+double Overflow() {
+  return std::ldexp(2.0 - std::ldexp(1.0, -M - 1), (1 << (E - 1)) - 1);
+}
+
+inline float FloatOf(const std::uint32_t bits) {
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+// the half bits moved into a float and rebased from bias 15 to bias 127,
+// which is exact for normal and subnormal halves alike
+inline double HalfToDouble(const std::uint16_t h) {
+  const std::uint32_t bits = std::uint32_t(h & 0x7fff) << 13 |
+                             std::uint32_t(h & 0x8000) << 16;
+  return double(FloatOf(bits)) * 0x1p112;
+}
+
+inline double BfloatToDouble(const std::uint16_t h) {
+  return FloatOf(std::uint32_t(h) << 16);
+}
+
+// Groups of sixteen have a fixed trip count, which the -O2 vectorizer
+// takes for all three conversions. int8_t is a char type that may alias
+// anything, hence the restricts.
+template <class T, class F>
+void Decode(const T* __restrict src, const int count, double* __restrict dst,
+            F&& decode) noexcept {
+  int j = 0;
+  for (; j + 16 <= count; j += 16) {
+    for (int u = 0; u < 16; ++u) dst[j + u] = decode(src[j + u]);
+  }
+  for (; j < count; ++j) dst[j] = decode(src[j]);
+}
+
+}  // namespace
+
+S21QuantizedMatrix::S21QuantizedMatrix(const S21Matrix& m, Format format)
+    : rows_(m.get_Row()), cols_(m.get_Col()), format_(format) {
+  if (rows_ < 1 || cols_ < 1) {
+    throw std::invalid_argument("Invalid argument");
+  }
+  const std::size_t count = std::size_t(rows_) * cols_;
+  if (format == Format::kInt8) {
+    int8_.resize(count);
+    scale_.resize(rows_);
+  } else {
+    half_.resize(count);
+  }
+  row_error_.resize(rows_);
+  const double limit = format == Format::kHalf
+                           ? Overflow<5, 10>()
+                           : format == Format::kBfloat16
+                                 ? Overflow<8, 7>()
+                                 : std::numeric_limits<double>::infinity();
+  std::atomic<bool> invalid{false};
+  S21ThreadPool::Instance().ParallelFor(0, rows_, cols_, [&](int lo, int hi) {
+    for (int i = lo; i < hi; ++i) {
+      const double* src = m.data(i);
+      const std::size_t base = std::size_t(i) * cols_;
+      bool bad = false;
+      double amax = 0;
+      for (int j = 0; j < cols_; ++j) {
+        bad |= !(std::fabs(src[j]) < limit);  // also catches NaN
+        amax = std::max(amax, std::fabs(src[j]));
+      }
+      if (bad) {
+        invalid.store(true, std::memory_order_relaxed);
+        continue;
+      }
+      if (format_ == Format::kInt8) {
+        const double scale = amax / 127;
+        scale_[i] = scale;
+        for (int j = 0; j < cols_; ++j) {
+          int8_[base + j] = static_cast<std::int8_t>(
+              scale > 0 ? std::nearbyint(src[j] / scale) : 0);
+        }
+      } else if (format_ == Format::kHalf) {
+        for (int j = 0; j < cols_; ++j) {
+          half_[base + j] = Encode<5, 10>(src[j]);
+        }
+      } else {
+        for (int j = 0; j < cols_; ++j) {
+          half_[base + j] = Encode<8, 7>(src[j]);
+        }
+      }
+      double decoded[kPanel];
+      double err = 0;
+      for (int j0 = 0; j0 < cols_; j0 += kPanel) {
+        const int w = std::min(kPanel, cols_ - j0);
+        DecodeRow(i, j0, w, decoded);
+        for (int j = 0; j < w; ++j) {
+          err = std::max(err, std::fabs(decoded[j] - src[j0 + j]));
+        }
+      }
+      row_error_[i] = err;
+    }
+  });
+  if (invalid.load()) {
+    throw std::invalid_argument(
+        "S21QuantizedMatrix: value does not fit the format");
+  }
+}
+
+void S21QuantizedMatrix::DecodeRow(int row, int col, int count,
+                                   double* dst) const noexcept {
+  const std::size_t base = std::size_t(row) * cols_ + col;
+  if (format_ == Format::kInt8) {
+    const double scale = scale_[row];
+    Decode(int8_.data() + base, count, dst,
+           [scale](std::int8_t q) { return q * scale; });
+  } else if (format_ == Format::kHalf) {
+    Decode(half_.data() + base, count, dst, HalfToDouble);
+  } else {
+    Decode(half_.data() + base, count, dst, BfloatToDouble);
+  }
+}
+
+S21Matrix S21QuantizedMatrix::ToDense() const {
+  S21Matrix res(rows_, cols_);
+  S21ThreadPool::Instance().ParallelFor(0, rows_, cols_, [&](int lo, int hi) {
+    for (int i = lo; i < hi; ++i) DecodeRow(i, 0, cols_, res.data(i));
+  });
+  return res;
+}
+
+double S21QuantizedMatrix::operator()(int row, int col) const {
+  if (row < 0 || row >= rows_) {
+    throw std::out_of_range("Incorrect input, row is out of range");
+  }
+  if (col < 0 || col >= cols_) {
+    throw std::out_of_range("Incorrect input, col is out of range");
+  }
+  double v;
+  DecodeRow(row, col, 1, &v);
+  return v;
+}
+
+S21Matrix S21QuantizedMatrix::MulMatrix(const S21Matrix& o) const {
+  S21Matrix res(rows_, o.get_Col());
+  MulInto(*this, o, res);
+  return res;
+}
+
+// Row i of a is decoded once into a buffer, then the product row is
+// accumulated exactly like the plain dense kernel does it.
+void S21QuantizedMatrix::MulInto(const S21QuantizedMatrix& a,
+                                 const S21Matrix& b, S21Matrix& out) {
+  if (a.cols_ != b.get_Row()) {
+    throw std::invalid_argument("MulInto: cannot multiply matrices");
+  }
+  if (&out == &b) {
+    throw std::invalid_argument("MulInto: out must not alias an operand");
+  }
+  const int depth = a.cols_;
+  const int cols = b.get_Col();
+  if (out.get_Row() != a.rows_ || out.get_Col() != cols) {
+    out = S21Matrix(a.rows_, cols);
+  }
+  S21ThreadPool::Instance().ParallelFor(
+      0, a.rows_, long(depth) * cols, [&](int lo, int hi) {
+        std::vector<double> row(depth);
+        for (int i = lo; i < hi; ++i) {
+          a.DecodeRow(i, 0, depth, row.data());
+          double* __restrict res = out.data(i);
+          std::fill(res, res + cols, 0.0);
+          for (int x = 0; x < depth; ++x) {
+            const double k = row[x];
+            const double* __restrict brow = b.data(x);
+            for (int j = 0; j < cols; ++j) res[j] += k * brow[j];
+          }
+        }
+      });
+}
+
+// Workers own column panels of the result. Each row of a panel of b is
+// decoded once per kRowBlock rows of the result, so the compressed operand
+// is read about once while the decoded values stay in L1.
+void S21QuantizedMatrix::MulInto(const S21Matrix& a,
+                                 const S21QuantizedMatrix& b,
+                                 S21Matrix& out) {
+  if (a.get_Col() != b.rows_) {
+    throw std::invalid_argument("MulInto: cannot multiply matrices");
+  }
+  if (&out == &a) {
+    throw std::invalid_argument("MulInto: out must not alias an operand");
+  }
+  const int rows = a.get_Row();
+  const int depth = b.rows_;
+  const int cols = b.cols_;
+  if (out.get_Row() != rows || out.get_Col() != cols) {
+    out = S21Matrix(rows, cols);
+  }
+  const int panels = (cols + kPanel - 1) / kPanel;
+  S21ThreadPool::Instance().ParallelFor(
+      0, panels, long(rows) * depth * kPanel, [&](int lo, int hi) {
+        double panel[kPanel];
+        for (int p = lo; p < hi; ++p) {
+          const int j0 = p * kPanel;
+          const int w = std::min(kPanel, cols - j0);
+          for (int i = 0; i < rows; ++i) {
+            std::fill(out.data(i) + j0, out.data(i) + j0 + w, 0.0);
+          }
+          for (int i0 = 0; i0 < rows; i0 += kRowBlock) {
+            const int i1 = std::min(rows, i0 + kRowBlock);
+            for (int x = 0; x < depth; ++x) {
+              b.DecodeRow(x, j0, w, panel);
+              int i = i0;
+              // four result rows per pass share the loads of the panel
+              for (; i + 4 <= i1; i += 4) {
+                const double k0 = a.data(i)[x], k1 = a.data(i + 1)[x];
+                const double k2 = a.data(i + 2)[x], k3 = a.data(i + 3)[x];
+                double* __restrict r0 = out.data(i) + j0;
+                double* __restrict r1 = out.data(i + 1) + j0;
+                double* __restrict r2 = out.data(i + 2) + j0;
+                double* __restrict r3 = out.data(i + 3) + j0;
+                for (int j = 0; j < w; ++j) {
+                  r0[j] += k0 * panel[j];
+                  r1[j] += k1 * panel[j];
+                  r2[j] += k2 * panel[j];
+                  r3[j] += k3 * panel[j];
+                }
+              }
+              for (; i < i1; ++i) {
+                const double k = a.data(i)[x];
+                double* __restrict res = out.data(i) + j0;
+                for (int j = 0; j < w; ++j) res[j] += k * panel[j];
+              }
+            }
+          }
+        }
+      });
+}
+
+double S21QuantizedMatrix::get_Error() const {
+  return *std::max_element(row_error_.begin(), row_error_.end());
+}
+
+// |dA * B|_ij <= err_i * sum_x |b_xj|
+double S21QuantizedMatrix::ErrorBound(const S21QuantizedMatrix& a,
+                                      const S21Matrix& b) {
+  if (a.cols_ != b.get_Row()) {
+    throw std::invalid_argument("ErrorBound: cannot multiply matrices");
+  }
+  std::vector<double> col_sum(b.get_Col(), 0.0);
+  for (int x = 0; x < b.get_Row(); ++x) {
+    const double* row = b.data(x);
+    for (int j = 0; j < b.get_Col(); ++j) col_sum[j] += std::fabs(row[j]);
+  }
+  return a.get_Error() * *std::max_element(col_sum.begin(), col_sum.end());
+}
+
+// |A * dB|_ij <= sum_x |a_ix| * err_x
+double S21QuantizedMatrix::ErrorBound(const S21Matrix& a,
+                                      const S21QuantizedMatrix& b) {
+  if (a.get_Col() != b.rows_) {
+    throw std::invalid_argument("ErrorBound: cannot multiply matrices");
+  }
+  double bound = 0;
+  for (int i = 0; i < a.get_Row(); ++i) {
+    const double* row = a.data(i);
+    double sum = 0;
+    for (int x = 0; x < b.rows_; ++x) {
+      sum += std::fabs(row[x]) * b.row_error_[x];
+    }
+    bound = std::max(bound, sum);
+  }
+  return bound;
+}
+
+int S21QuantizedMatrix::get_Row() const { return rows_; }
+
+int S21QuantizedMatrix::get_Col() const { return cols_; }
+
+S21QuantizedMatrix::Format S21QuantizedMatrix::get_Format() const {
+  return format_;
+}
+
+std::size_t S21QuantizedMatrix::Bytes() const {
+  return half_.size() * sizeof(std::uint16_t) +
+         int8_.size() * sizeof(std::int8_t) +
+         (scale_.size() + row_error_.size()) * sizeof(double);
+}
@@ -0,0 +1,56 @@
+#ifndef __S21_MATRIX_QUANT_H__
+#define __S21_MATRIX_QUANT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "s21_matrix_oop.h"
+
+// Reduced-precision copy of a matrix for bandwidth-bound products: IEEE
+// half (kHalf) and bfloat16 (kBfloat16) take 2 bytes per element and round
+// to nearest even, kInt8 takes 1 byte per element and one scale per row,
+// max |row| / 127. Products decode small panels of the compressed operand
+// into an L1-sized buffer and accumulate in double, in the summation order
+// of the dense kernels, so they match the dense product of ToDense().
+class S21QuantizedMatrix {
+ public:
+  enum class Format { kHalf, kBfloat16, kInt8 };
+
+  // throws std::invalid_argument for values that are not finite or do not
+  // fit the format (65520 and beyond in magnitude for kHalf)
+  S21QuantizedMatrix(const S21Matrix& m, Format format);
+  S21Matrix ToDense() const;
+  double operator()(int row, int col) const;
+
+  S21Matrix MulMatrix(const S21Matrix& o) const;  // this * o
+  static void MulInto(const S21QuantizedMatrix& a, const S21Matrix& b,
+                      S21Matrix& out);
+  static void MulInto(const S21Matrix& a, const S21QuantizedMatrix& b,
+                      S21Matrix& out);
+
+  // largest |ToDense() - m| over the elements of the source m
+  double get_Error() const;
+  // bound on the largest deviation of the product from the product of the
+  // source, apart from the rounding of the double accumulation itself
+  static double ErrorBound(const S21QuantizedMatrix& a, const S21Matrix& b);
+  static double ErrorBound(const S21Matrix& a, const S21QuantizedMatrix& b);
+
+  int get_Row() const;
+  int get_Col() const;
+  Format get_Format() const;
+  std::size_t Bytes() const;  // resident size of elements and scales
+
+ private:
+  // dst[j] = element (row, col + j) for j < count
+  void DecodeRow(int row, int col, int count, double* dst) const noexcept;
+
+  int rows_, cols_;
+  Format format_;
+  std::vector<std::uint16_t> half_;  // kHalf and kBfloat16 bits
+  std::vector<std::int8_t> int8_;
+  std::vector<double> scale_;      // per row, kInt8 only
+  std::vector<double> row_error_;  // largest quantization error per row
+};
+
+#endif
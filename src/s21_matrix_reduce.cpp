@@ -0,0 +1,372 @@
+#include "s21_matrix_reduce.h"
+
+#include "s21_parallel.h"
+
+namespace {
+
+// Independent accumulators per row, and the group size of the element-wise
+// loops: fixed trip counts are what the -O2 vectorizer takes whole.
+constexpr int kLanes = 8;
+// Rows one task folds into its own column accumulators.
+constexpr int kRowChunk = 64;
+
+// f(j) for every j < n
+template <class F>
+inline void ForEach(const int n, F&& f) {
+  int j = 0;
+  for (; j + kLanes <= n; j += kLanes) {
+    for (int u = 0; u < kLanes; ++u) f(j + u);
+  }
+  for (; j < n; ++j) f(j);
+}
+
+// op over g(x[j], j) for j < n, starting from init
+template <class G, class Op>
+double FoldRow(const double* __restrict x, const int n, const double init,
+               G&& g, Op&& op) {
+  double acc[kLanes];
+  for (int u = 0; u < kLanes; ++u) acc[u] = init;
+  int j = 0;
+  for (; j + kLanes <= n; j += kLanes) {
+    for (int u = 0; u < kLanes; ++u) acc[u] = op(acc[u], g(x[j + u], j + u));
+  }
+  for (; j < n; ++j) acc[0] = op(acc[0], g(x[j], j));
+  double res = acc[0];
+  for (int u = 1; u < kLanes; ++u) res = op(res, acc[u]);
+  return res;
+}
+
+// m x 1 result of FoldRow over every row
+template <class G, class Op>
+S21Matrix FoldRows(const S21Matrix& m, const double init, G&& g, Op&& op) {
+  const int cols = m.get_Col();
+  S21Matrix res(m.get_Row(), 1);
+  S21ThreadPool::Instance().ParallelFor(
+      0, m.get_Row(), cols, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+          res.data(i)[0] = FoldRow(m.data(i), cols, init, g, op);
+        }
+      });
+  return res;
+}
+
+// op over g(x_ij, j) down every column j. Chunks of kRowChunk rows fold in
+// parallel into their own accumulators, merged chunk by chunk afterwards.
+template <class G, class Op>
+std::vector<double> FoldCols(const S21Matrix& m, const double init, G&& g,
+                             Op&& op) {
+  const int rows = m.get_Row();
+  const int cols = m.get_Col();
+  const int chunks = (rows + kRowChunk - 1) / kRowChunk;
+  std::vector<double> part(std::size_t(chunks) * cols, init);
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  pool.ParallelFor(0, chunks, long(kRowChunk) * cols, [&](int lo, int hi) {
+    for (int c = lo; c < hi; ++c) {
+      double* __restrict acc = part.data() + std::size_t(c) * cols;
+      const int end = std::min(rows, (c + 1) * kRowChunk);
+      for (int i = c * kRowChunk; i < end; ++i) {
+        const double* __restrict x = m.data(i);
+        ForEach(cols, [&](int j) { acc[j] = op(acc[j], g(x[j], j)); });
+      }
+    }
+  });
+  pool.ParallelFor(0, cols, chunks, [&](int lo, int hi) {
+    double* __restrict acc = part.data();
+    for (int c = 1; c < chunks; ++c) {
+      const double* __restrict x = part.data() + std::size_t(c) * cols;
+      for (int j = lo; j < hi; ++j) acc[j] = op(acc[j], x[j]);
+    }
+  });
+  part.resize(cols);
+  return part;
+}
+
+S21Matrix RowOf(const std::vector<double>& values) {
+  S21Matrix res(1, static_cast<int>(values.size()));
+  std::copy(values.begin(), values.end(), res.data(0));
+  return res;
+}
+
+template <class G, class Op>
+S21Matrix Fold(const S21Matrix& m, const S21Axis axis, const double init,
+               G&& g, Op&& op) {
+  if (axis == S21Axis::kRows) return FoldRows(m, init, g, op);
+  return RowOf(FoldCols(m, init, g, op));
+}
+
+// r = f(r) for every element of a reduction result
+template <class F>
+void Finish(S21Matrix& r, F&& f) {
+  for (int i = 0; i < r.get_Row(); ++i) {
+    double* x = r.data(i);
+    for (int j = 0; j < r.get_Col(); ++j) x[j] = f(x[j]);
+  }
+}
+
+int Count(const S21Matrix& m, const S21Axis axis) {
+  return axis == S21Axis::kRows ? m.get_Col() : m.get_Row();
+}
+
+constexpr auto kPlus = [](double a, double b) { return a + b; };
+constexpr auto kMin = [](double a, double b) { return b < a ? b : a; };
+constexpr auto kMax = [](double a, double b) { return a < b ? b : a; };
+constexpr auto kValue = [](double x, int) { return x; };
+constexpr auto kAbs = [](double x, int) { return std::fabs(x); };
+
+// first index of the best element by better(x, y) of every row or column
+template <class Better>
+std::vector<int> ArgBest(const S21Matrix& m, const S21Axis axis,
+                         Better&& better) {
+  const int rows = m.get_Row();
+  const int cols = m.get_Col();
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  if (axis == S21Axis::kRows) {
+    std::vector<int> res(rows);
+    pool.ParallelFor(0, rows, cols, [&](int lo, int hi) {
+      for (int i = lo; i < hi; ++i) {
+        const double* x = m.data(i);
+        const double best =
+            FoldRow(x, cols, x[0], kValue,
+                    [&](double a, double b) { return better(b, a) ? b : a; });
+        int j = 0;
+        while (x[j] != best) ++j;
+        res[i] = j;
+      }
+    });
+    return res;
+  }
+  const int chunks = (rows + kRowChunk - 1) / kRowChunk;
+  std::vector<double> value(std::size_t(chunks) * cols);
+  std::vector<int> index(std::size_t(chunks) * cols);
+  pool.ParallelFor(0, chunks, long(kRowChunk) * cols, [&](int lo, int hi) {
+    for (int c = lo; c < hi; ++c) {
+      double* __restrict v = value.data() + std::size_t(c) * cols;
+      int* __restrict k = index.data() + std::size_t(c) * cols;
+      std::copy(m.data(c * kRowChunk), m.data(c * kRowChunk) + cols, v);
+      std::fill(k, k + cols, c * kRowChunk);
+      const int end = std::min(rows, (c + 1) * kRowChunk);
+      for (int i = c * kRowChunk + 1; i < end; ++i) {
+        const double* __restrict x = m.data(i);
+        ForEach(cols, [&](int j) {
+          const bool b = better(x[j], v[j]);
+          v[j] = b ? x[j] : v[j];
+          k[j] = b ? i : k[j];
+        });
+      }
+    }
+  });
+  // chunks in order and strict comparisons keep the first index on ties
+  for (int c = 1; c < chunks; ++c) {
+    for (int j = 0; j < cols; ++j) {
+      const std::size_t at = std::size_t(c) * cols + j;
+      if (better(value[at], value[j])) {
+        value[j] = value[at];
+        index[j] = index[at];
+      }
+    }
+  }
+  index.resize(cols);
+  return index;
+}
+
+enum class Shape { kSame, kRow, kCol, kScalar };
+
+Shape ShapeOf(const S21Matrix& m, const S21Matrix& v) {
+  if (v.get_Row() == m.get_Row() && v.get_Col() == m.get_Col()) {
+    return Shape::kSame;
+  }
+  if (v.get_Row() == 1 && v.get_Col() == m.get_Col()) return Shape::kRow;
+  if (v.get_Col() == 1 && v.get_Row() == m.get_Row()) return Shape::kCol;
+  if (v.get_Row() == 1 && v.get_Col() == 1) return Shape::kScalar;
+  throw std::invalid_argument("Broadcast: shapes do not match");
+}
+
+// out = m op v, out may be m itself but must not be v
+template <class Op>
+void Combine(const S21Matrix& m, const S21Matrix& v, S21Matrix& out,
+             Op&& op) {
+  const Shape shape = ShapeOf(m, v);
+  const int cols = m.get_Col();
+  const bool in_place = &out == &m;
+  S21ThreadPool::Instance().ParallelFor(
+      0, m.get_Row(), cols, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+          double* __restrict o = out.data(i);
+          if (shape == Shape::kSame || shape == Shape::kRow) {
+            const double* __restrict b = v.data(shape == Shape::kSame ? i : 0);
+            if (in_place) {
+              ForEach(cols, [&](int j) { o[j] = op(o[j], b[j]); });
+            } else {
+              const double* __restrict a = m.data(i);
+              ForEach(cols, [&](int j) { o[j] = op(a[j], b[j]); });
+            }
+          } else {
+            const double s = v.data(shape == Shape::kCol ? i : 0)[0];
+            if (in_place) {
+              ForEach(cols, [&](int j) { o[j] = op(o[j], s); });
+            } else {
+              const double* __restrict a = m.data(i);
+              ForEach(cols, [&](int j) { o[j] = op(a[j], s); });
+            }
+          }
+        }
+      });
+}
+
+void Dispatch(const S21Matrix& m, const S21Broadcast::Op op,
+              const S21Matrix& v, S21Matrix& out) {
+  switch (op) {
+    case S21Broadcast::Op::kAdd:
+      Combine(m, v, out, [](double a, double b) { return a + b; });
+      break;
+    case S21Broadcast::Op::kSub:
+      Combine(m, v, out, [](double a, double b) { return a - b; });
+      break;
+    case S21Broadcast::Op::kMul:
+      Combine(m, v, out, [](double a, double b) { return a * b; });
+      break;
+    case S21Broadcast::Op::kDiv:
+      Combine(m, v, out, [](double a, double b) { return a / b; });
+      break;
+  }
+}
+
+}  // namespace
+
+S21Matrix S21Reduce::Sum(const S21Matrix& m, const S21Axis axis) {
+  return Fold(m, axis, 0, kValue, kPlus);
+}
+
+S21Matrix S21Reduce::Mean(const S21Matrix& m, const S21Axis axis) {
+  S21Matrix res = Sum(m, axis);
+  const double n = Count(m, axis);
+  Finish(res, [n](double s) { return s / n; });
+  return res;
+}
+
+S21Matrix S21Reduce::Min(const S21Matrix& m, const S21Axis axis) {
+  return Fold(m, axis, std::numeric_limits<double>::infinity(), kValue, kMin);
+}
+
+S21Matrix S21Reduce::Max(const S21Matrix& m, const S21Axis axis) {
+  return Fold(m, axis, -std::numeric_limits<double>::infinity(), kValue,
+              kMax);
+}
+
+std::vector<int> S21Reduce::ArgMin(const S21Matrix& m, const S21Axis axis) {
+  return ArgBest(m, axis, [](double a, double b) { return a < b; });
+}
+
+std::vector<int> S21Reduce::ArgMax(const S21Matrix& m, const S21Axis axis) {
+  return ArgBest(m, axis, [](double a, double b) { return a > b; });
+}
+
+S21Matrix S21Reduce::Norm(const S21Matrix& m, const S21Axis axis,
+                          const double p) {
+  if (!(p >= 1)) {
+    throw std::invalid_argument("Norm: p must be at least 1");
+  }
+  if (p == 1) return Fold(m, axis, 0, kAbs, kPlus);
+  if (std::isinf(p)) return Fold(m, axis, 0, kAbs, kMax);
+  if (p == 2) {
+    S21Matrix res =
+        Fold(m, axis, 0, [](double x, int) { return x * x; }, kPlus);
+    Finish(res, [](double s) { return std::sqrt(s); });
+    return res;
+  }
+  S21Matrix res = Fold(
+      m, axis, 0, [p](double x, int) { return std::pow(std::fabs(x), p); },
+      kPlus);
+  Finish(res, [p](double s) { return std::pow(s, 1 / p); });
+  return res;
+}
+
+S21Matrix S21Reduce::Variance(const S21Matrix& m, const S21Axis axis,
+                              const int ddof) {
+  const double n = Count(m, axis) - ddof;
+  if (ddof < 0 || n <= 0) {
+    throw std::invalid_argument("Variance: ddof out of range");
+  }
+  const S21Matrix mean = Mean(m, axis);
+  if (axis == S21Axis::kRows) {
+    S21Matrix res(m.get_Row(), 1);
+    S21ThreadPool::Instance().ParallelFor(
+        0, m.get_Row(), m.get_Col(), [&](int lo, int hi) {
+          for (int i = lo; i < hi; ++i) {
+            const double mu = mean.data(i)[0];
+            const double s = FoldRow(
+                m.data(i), m.get_Col(), 0,
+                [mu](double x, int) { return (x - mu) * (x - mu); }, kPlus);
+            res.data(i)[0] = s / n;
+          }
+        });
+    return res;
+  }
+  const double* mu = mean.data(0);
+  S21Matrix res = RowOf(FoldCols(
+      m, 0, [mu](double x, int j) { return (x - mu[j]) * (x - mu[j]); },
+      kPlus));
+  Finish(res, [n](double s) { return s / n; });
+  return res;
+}
+
+S21Matrix S21Broadcast::Apply(const S21Matrix& m, const Op op,
+                              const S21Matrix& v) {
+  S21Matrix res(m.get_Row(), m.get_Col());
+  Dispatch(m, op, v, res);
+  return res;
+}
+
+void S21Broadcast::ApplyInPlace(S21Matrix& m, const Op op,
+                                const S21Matrix& v) {
+  if (&v == &m) {
+    const S21Matrix copy(v);
+    Dispatch(m, op, copy, m);
+    return;
+  }
+  Dispatch(m, op, v, m);
+}
+
+S21Matrix S21Broadcast::Add(const S21Matrix& m, const S21Matrix& v) {
+  return Apply(m, Op::kAdd, v);
+}
+
+S21Matrix S21Broadcast::Sub(const S21Matrix& m, const S21Matrix& v) {
+  return Apply(m, Op::kSub, v);
+}
+
+S21Matrix S21Broadcast::Mul(const S21Matrix& m, const S21Matrix& v) {
+  return Apply(m, Op::kMul, v);
+}
+
+S21Matrix S21Broadcast::Div(const S21Matrix& m, const S21Matrix& v) {
+  return Apply(m, Op::kDiv, v);
+}
+
+S21Matrix S21Broadcast::MeanCenter(S21Matrix& m, const S21Axis axis) {
+  const int cols = m.get_Col();
+  if (axis == S21Axis::kRows) {
+    S21Matrix means(m.get_Row(), 1);
+    S21ThreadPool::Instance().ParallelFor(
+        0, m.get_Row(), 2L * cols, [&](int lo, int hi) {
+          for (int i = lo; i < hi; ++i) {
+            double* __restrict x = m.data(i);
+            const double mu = FoldRow(x, cols, 0, kValue, kPlus) / cols;
+            ForEach(cols, [&](int j) { x[j] -= mu; });
+            means.data(i)[0] = mu;
+          }
+        });
+    return means;
+  }
+  std::vector<double> mu = FoldCols(m, 0, kValue, kPlus);
+  for (double& s : mu) s /= m.get_Row();
+  const double* __restrict c = mu.data();
+  S21ThreadPool::Instance().ParallelFor(
+      0, m.get_Row(), cols, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+          double* __restrict x = m.data(i);
+          ForEach(cols, [&](int j) { x[j] -= c[j]; });
+        }
+      });
+  return RowOf(mu);
+}
@@ -0,0 +1,55 @@
+#ifndef __S21_MATRIX_REDUCE_H__
+#define __S21_MATRIX_REDUCE_H__
+
+#include <vector>
+
+#include "s21_matrix_oop.h"
+
+// kRows gives one value per row, an m x 1 column; kCols gives one value per
+// column, a 1 x n row. The results broadcast straight back over the matrix.
+enum class S21Axis { kRows, kCols };
+
+// Reductions along an axis. Rows are read straight from the storage in
+// fixed groups of lanes that the vectorizer keeps in SIMD registers; long
+// matrices are split into row chunks folded in parallel and merged in a
+// fixed order, so results do not depend on the number of workers. Min, max
+// and their arg versions assume there are no NaNs.
+class S21Reduce {
+ public:
+  static S21Matrix Sum(const S21Matrix& m, const S21Axis axis);
+  static S21Matrix Mean(const S21Matrix& m, const S21Axis axis);
+  static S21Matrix Min(const S21Matrix& m, const S21Axis axis);
+  static S21Matrix Max(const S21Matrix& m, const S21Axis axis);
+  // index of the first minimum (maximum) of every row or column
+  static std::vector<int> ArgMin(const S21Matrix& m, const S21Axis axis);
+  static std::vector<int> ArgMax(const S21Matrix& m, const S21Axis axis);
+  // p-norm for p >= 1, p = infinity gives the largest magnitude
+  static S21Matrix Norm(const S21Matrix& m, const S21Axis axis,
+                        const double p = 2);
+  // two-pass variance, sum (x - mean)^2 / (count - ddof)
+  static S21Matrix Variance(const S21Matrix& m, const S21Axis axis,
+                            const int ddof = 0);
+};
+
+// Element-wise m op v where v is the same shape as m, a 1 x n row applied
+// to every row, an m x 1 column applied to every column, or a 1 x 1 scalar.
+// kMul and kDiv with a same-shape v are the Hadamard product and quotient.
+class S21Broadcast {
+ public:
+  enum class Op { kAdd, kSub, kMul, kDiv };
+
+  static S21Matrix Apply(const S21Matrix& m, const Op op, const S21Matrix& v);
+  // writes over m: one read and one write of every element
+  static void ApplyInPlace(S21Matrix& m, const Op op, const S21Matrix& v);
+  static S21Matrix Add(const S21Matrix& m, const S21Matrix& v);
+  static S21Matrix Sub(const S21Matrix& m, const S21Matrix& v);
+  static S21Matrix Mul(const S21Matrix& m, const S21Matrix& v);
+  static S21Matrix Div(const S21Matrix& m, const S21Matrix& v);
+
+  // subtracts the mean along axis from m and returns the means: one pass to
+  // sum and one to write; with kRows each row is still in cache for the
+  // write
+  static S21Matrix MeanCenter(S21Matrix& m, const S21Axis axis);
+};
+
+#endif
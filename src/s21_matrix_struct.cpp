@@ -0,0 +1,486 @@
+#include "s21_matrix_struct.h"
+
+#include <atomic>
+#include <cmath>
+
+#include "s21_parallel.h"
+
+namespace {
+
+void AtomicMax(std::atomic<int>& target, const int value) {
+  int cur = target.load(std::memory_order_relaxed);
+  while (cur < value && !target.compare_exchange_weak(cur, value)) {
+  }
+}
+
+void CheckRange(const int row, const int rows, const int col,
+                const int cols) {
+  if (row < 0 || row >= rows) {
+    throw std::out_of_range("Incorrect input, row is out of range");
+  }
+  if (col < 0 || col >= cols) {
+    throw std::out_of_range("Incorrect input, col is out of range");
+  }
+}
+
+}  // namespace
+
+S21Structure S21Structure::Detect(const S21Matrix& m, const double eps) {
+  const int rows = m.get_Row();
+  const int cols = m.get_Col();
+  std::atomic<int> kl(0), ku(0);
+  std::atomic<bool> symmetric(rows == cols);
+  S21ThreadPool::Instance().ParallelFor(0, rows, cols, [&](int lo, int hi) {
+    int lower = 0, upper = 0;
+    bool sym = symmetric.load(std::memory_order_relaxed);
+    for (int i = lo; i < hi; ++i) {
+      const double* row = m.data(i);
+      for (int j = 0; j < i - lower && j < cols; ++j) {
+        if (std::fabs(row[j]) > eps) {
+          lower = i - j;
+          break;
+        }
+      }
+      for (int j = cols - 1; j > i + upper; --j) {
+        if (std::fabs(row[j]) > eps) {
+          upper = j - i;
+          break;
+        }
+      }
+      // the lower half of row i against column i, until the first mismatch
+      for (int j = 0; sym && j < i; ++j) {
+        sym = std::fabs(row[j] - m.at_unchecked(j, i)) <= eps;
+      }
+    }
+    AtomicMax(kl, lower);
+    AtomicMax(ku, upper);
+    if (!sym) symmetric = false;
+  });
+  return S21Structure{rows == cols, symmetric, kl, ku};
+}
+
+S21PackedMatrix::S21PackedMatrix(int n, Kind kind) : n_(n), kind_(kind) {
+  if (n < 1) {
+    throw std::invalid_argument("Invalid argument");
+  }
+  packed_.assign(std::size_t(n) * (n + 1) / 2, 0.0);
+}
+
+S21PackedMatrix S21PackedMatrix::FromDense(const S21Matrix& m, Kind kind) {
+  if (m.get_Row() != m.get_Col()) {
+    throw std::invalid_argument("FromDense: the matrix is not square");
+  }
+  S21PackedMatrix res(m.get_Row(), kind);
+  const int n = res.n_;
+  S21ThreadPool::Instance().ParallelFor(0, n, n / 2, [&](int lo, int hi) {
+    for (int i = lo; i < hi; ++i) {
+      const int j0 = kind == Kind::kUpper ? i : 0;
+      const int j1 = kind == Kind::kUpper ? n : i + 1;
+      std::copy(m.data(i) + j0, m.data(i) + j1,
+                res.packed_.begin() + res.Index(i, j0));
+    }
+  });
+  return res;
+}
+
+S21Matrix S21PackedMatrix::ToDense() const {
+  S21Matrix res(n_, n_);
+  S21ThreadPool::Instance().ParallelFor(0, n_, n_, [&](int lo, int hi) {
+    for (int i = lo; i < hi; ++i) {
+      double* row = res.data(i);
+      for (int j = 0; j < n_; ++j) row[j] = (*this)(i, j);
+    }
+  });
+  return res;
+}
+
+std::size_t S21PackedMatrix::Index(int row, int col) const noexcept {
+  if (kind_ == Kind::kUpper) {
+    return std::size_t(row) * (2 * n_ - row + 1) / 2 + (col - row);
+  }
+  return std::size_t(row) * (row + 1) / 2 + col;
+}
+
+bool S21PackedMatrix::Stored(int row, int col) const noexcept {
+  return kind_ == Kind::kUpper ? col >= row : col <= row;
+}
+
+double S21PackedMatrix::operator()(int row, int col) const {
+  CheckRange(row, n_, col, n_);
+  if (kind_ == Kind::kSymmetric && col > row) std::swap(row, col);
+  return Stored(row, col) ? packed_[Index(row, col)] : 0.0;
+}
+
+double& S21PackedMatrix::at(int row, int col) {
+  CheckRange(row, n_, col, n_);
+  if (kind_ == Kind::kSymmetric && col > row) std::swap(row, col);
+  if (!Stored(row, col)) {
+    throw std::out_of_range("S21PackedMatrix: entry is a structural zero");
+  }
+  return packed_[Index(row, col)];
+}
+
+S21Matrix S21PackedMatrix::MulMatrix(const S21Matrix& b) const {
+  if (b.get_Row() != n_) {
+    throw std::invalid_argument("MulMatrix: cannot multiply matrices");
+  }
+  const int m = b.get_Col();
+  S21Matrix res(n_, m);
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  if (kind_ != Kind::kSymmetric) {
+    // every stored row makes one output row
+    pool.ParallelFor(0, n_, long(n_) * m / 2, [&](int lo, int hi) {
+      for (int i = lo; i < hi; ++i) {
+        double* out = res.data(i);
+        const int j0 = kind_ == Kind::kUpper ? i : 0;
+        const int j1 = kind_ == Kind::kUpper ? n_ : i + 1;
+        const double* a = packed_.data() + Index(i, j0) - j0;
+        for (int j = j0; j < j1; ++j) {
+          const double* in = b.data(j);
+          for (int c = 0; c < m; ++c) out[c] += a[j] * in[c];
+        }
+      }
+    });
+    return res;
+  }
+  // a stored a(i, j) also stands for a(j, i) and feeds output rows i and j,
+  // so the workers split the columns instead
+  pool.ParallelFor(0, m, long(n_) * n_, [&](int lo, int hi) {
+    for (int i = 0; i < n_; ++i) {
+      const double* a = packed_.data() + Index(i, 0);
+      const double* bi = b.data(i);
+      double* out = res.data(i);
+      for (int j = 0; j < i; ++j) {
+        const double* bj = b.data(j);
+        double* out_j = res.data(j);
+        for (int c = lo; c < hi; ++c) {
+          out[c] += a[j] * bj[c];
+          out_j[c] += a[j] * bi[c];
+        }
+      }
+      for (int c = lo; c < hi; ++c) out[c] += a[i] * bi[c];
+    }
+  });
+  return res;
+}
+
+S21Matrix S21PackedMatrix::Solve(const S21Matrix& b) const {
+  if (kind_ == Kind::kSymmetric) {
+    throw std::logic_error("Solve: the matrix is not triangular");
+  }
+  if (b.get_Row() != n_) {
+    throw std::invalid_argument("Solve: incorrect right-hand side size");
+  }
+  for (int i = 0; i < n_; ++i) {
+    if (packed_[Index(i, i)] == 0) {
+      throw std::logic_error("Solve: the matrix is singular");
+    }
+  }
+  S21Matrix x = b;
+  const int m = b.get_Col();
+  const bool lower = kind_ == Kind::kLower;
+  S21ThreadPool::Instance().ParallelFor(0, m, long(n_) * n_ / 2,
+                                        [&](int lo, int hi) {
+    for (int step = 0; step < n_; ++step) {
+      const int i = lower ? step : n_ - 1 - step;
+      const int j0 = lower ? 0 : i + 1;
+      const int j1 = lower ? i : n_;
+      const double* a = packed_.data() + Index(i, i) - i;
+      double* xi = x.data(i);
+      for (int j = j0; j < j1; ++j) {
+        const double* xj = x.data(j);
+        for (int c = lo; c < hi; ++c) xi[c] -= a[j] * xj[c];
+      }
+      for (int c = lo; c < hi; ++c) xi[c] /= a[i];
+    }
+  });
+  return x;
+}
+
+double S21PackedMatrix::Determinant() const {
+  double res = 1;
+  if (kind_ != Kind::kSymmetric) {
+    for (int i = 0; i < n_; ++i) res *= packed_[Index(i, i)];
+    return res;
+  }
+  // LDL^T with Bunch-Kaufman pivoting on a copy of the packed triangle.
+  // The symmetric interchanges leave the determinant alone, so it is the
+  // product of the 1 x 1 and 2 x 2 blocks of D.
+  const int n = n_;
+  std::vector<double> a = packed_;
+  auto at = [&a](const int i, const int j) -> double& {
+    return a[std::size_t(i) * (i + 1) / 2 + j];  // i >= j
+  };
+  const double alpha = (1 + std::sqrt(17.0)) / 8;
+  std::vector<double> w0(n), w1(n);  // columns of L D for the update
+  for (int k = 0; k < n;) {
+    const double absakk = std::fabs(at(k, k));
+    int imax = k;
+    double colmax = 0;
+    for (int i = k + 1; i < n; ++i) {
+      if (std::fabs(at(i, k)) > colmax) {
+        colmax = std::fabs(at(i, k));
+        imax = i;
+      }
+    }
+    if (std::max(absakk, colmax) == 0) return 0;
+    int kp = k, step = 1;
+    if (absakk < alpha * colmax) {
+      double rowmax = 0;
+      for (int j = k; j < imax; ++j) {
+        rowmax = std::max(rowmax, std::fabs(at(imax, j)));
+      }
+      for (int i = imax + 1; i < n; ++i) {
+        rowmax = std::max(rowmax, std::fabs(at(i, imax)));
+      }
+      if (absakk * rowmax < alpha * colmax * colmax) {
+        kp = imax;
+        if (std::fabs(at(imax, imax)) < alpha * rowmax) step = 2;
+      }
+    }
+    // swap rows and columns kk and kp of the trailing matrix
+    const int kk = k + step - 1;
+    if (kp != kk) {
+      std::swap(at(kk, kk), at(kp, kp));
+      for (int j = k; j < kk; ++j) std::swap(at(kk, j), at(kp, j));
+      for (int j = kk + 1; j < kp; ++j) std::swap(at(j, kk), at(kp, j));
+      for (int i = kp + 1; i < n; ++i) std::swap(at(i, kk), at(i, kp));
+    }
+    const int next = k + step;
+    if (step == 1) {
+      const double d = at(k, k);
+      res *= d;
+      for (int j = next; j < n; ++j) w0[j] = at(j, k) / d;
+    } else {
+      const double d11 = at(k, k), d21 = at(k + 1, k);
+      const double d22 = at(k + 1, k + 1);
+      const double det = d11 * d22 - d21 * d21;
+      res *= det;
+      for (int j = next; j < n; ++j) {
+        const double x = at(j, k), y = at(j, k + 1);
+        w0[j] = (d22 * x - d21 * y) / det;
+        w1[j] = (d11 * y - d21 * x) / det;
+      }
+    }
+    // rows are independent, each touches its own stretch of the triangle
+    S21ThreadPool::Instance().ParallelFor(
+        next, n, n - next, [&](int lo, int hi) {
+          for (int i = lo; i < hi; ++i) {
+            double* row = &at(i, 0);
+            const double x = row[k];
+            if (step == 1) {
+              for (int j = next; j <= i; ++j) row[j] -= x * w0[j];
+            } else {
+              const double y = row[k + 1];
+              for (int j = next; j <= i; ++j) {
+                row[j] -= x * w0[j] + y * w1[j];
+              }
+            }
+          }
+        });
+    k = next;
+  }
+  return res;
+}
+
+int S21PackedMatrix::get_Size() const { return n_; }
+
+S21PackedMatrix::Kind S21PackedMatrix::get_Kind() const { return kind_; }
+
+std::size_t S21PackedMatrix::Elements() const { return packed_.size(); }
+
+S21BandMatrix::S21BandMatrix(int rows, int cols, int kl, int ku)
+    : rows_(rows), cols_(cols), kl_(kl), ku_(ku) {
+  if (rows < 1 || cols < 1 || kl < 0 || ku < 0) {
+    throw std::invalid_argument("Invalid argument");
+  }
+  band_.assign(std::size_t(rows) * (kl + ku + 1), 0.0);
+}
+
+S21BandMatrix S21BandMatrix::FromDense(const S21Matrix& m, int kl, int ku) {
+  S21BandMatrix res(m.get_Row(), m.get_Col(), kl, ku);
+  const int w = kl + ku + 1;
+  S21ThreadPool::Instance().ParallelFor(0, res.rows_, w, [&](int lo, int hi) {
+    for (int i = lo; i < hi; ++i) {
+      const int j0 = std::max(0, i - kl);
+      const int j1 = std::min(res.cols_, i + ku + 1);
+      if (j0 >= j1) continue;
+      std::copy(m.data(i) + j0, m.data(i) + j1,
+                res.band_.begin() + std::size_t(i) * w + (j0 - i + kl));
+    }
+  });
+  return res;
+}
+
+S21Matrix S21BandMatrix::ToDense() const {
+  S21Matrix res(rows_, cols_);
+  const int w = kl_ + ku_ + 1;
+  S21ThreadPool::Instance().ParallelFor(0, rows_, cols_, [&](int lo, int hi) {
+    for (int i = lo; i < hi; ++i) {
+      const int j0 = std::max(0, i - kl_);
+      const int j1 = std::min(cols_, i + ku_ + 1);
+      const double* a = band_.data() + std::size_t(i) * w;
+      for (int j = j0; j < j1; ++j) res.at_unchecked(i, j) = a[j - i + kl_];
+    }
+  });
+  return res;
+}
+
+bool S21BandMatrix::InBand(int row, int col) const noexcept {
+  return col - row >= -kl_ && col - row <= ku_;
+}
+
+double S21BandMatrix::operator()(int row, int col) const {
+  CheckRange(row, rows_, col, cols_);
+  if (!InBand(row, col)) return 0.0;
+  return band_[std::size_t(row) * (kl_ + ku_ + 1) + (col - row + kl_)];
+}
+
+double& S21BandMatrix::at(int row, int col) {
+  CheckRange(row, rows_, col, cols_);
+  if (!InBand(row, col)) {
+    throw std::out_of_range("S21BandMatrix: entry is outside the band");
+  }
+  return band_[std::size_t(row) * (kl_ + ku_ + 1) + (col - row + kl_)];
+}
+
+S21Matrix S21BandMatrix::MulMatrix(const S21Matrix& b) const {
+  if (b.get_Row() != cols_) {
+    throw std::invalid_argument("MulMatrix: cannot multiply matrices");
+  }
+  const int m = b.get_Col();
+  const int w = kl_ + ku_ + 1;
+  S21Matrix res(rows_, m);
+  S21ThreadPool::Instance().ParallelFor(
+      0, rows_, long(w) * m, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+          double* out = res.data(i);
+          const double* a = band_.data() + std::size_t(i) * w + kl_;
+          const int j1 = std::min(cols_, i + ku_ + 1);
+          for (int j = std::max(0, i - kl_); j < j1; ++j) {
+            const double* in = b.data(j);
+            const double aij = a[j - i];
+            for (int c = 0; c < m; ++c) out[c] += aij * in[c];
+          }
+        }
+      });
+  return res;
+}
+
+// Gaussian elimination with partial pivoting restricted to the band, as in
+// LAPACK dgbtrf: the pivot is searched among the kl rows below, and a row
+// interchange can push the upper bandwidth to ku + kl.
+bool S21BandMatrix::Factor(std::vector<double>& lu, std::vector<int>& pivots,
+                           bool& odd) const {
+  const int n = rows_;
+  const int w = kl_ + ku_ + 1;
+  const int lw = 2 * kl_ + ku_ + 1;
+  lu.assign(std::size_t(n) * lw, 0.0);
+  pivots.assign(n, 0);
+  odd = false;
+  for (int i = 0; i < n; ++i) {
+    std::copy(band_.begin() + std::size_t(i) * w,
+              band_.begin() + std::size_t(i + 1) * w,
+              lu.begin() + std::size_t(i) * lw);
+  }
+  // element (i, j) of the factors
+  auto at = [&](int i, int j) -> double& {
+    return lu[std::size_t(i) * lw + (j - i + kl_)];
+  };
+  for (int k = 0; k < n; ++k) {
+    const int last_row = std::min(n - 1, k + kl_);
+    const int last_col = std::min(n - 1, k + kl_ + ku_);
+    int p = k;
+    for (int r = k + 1; r <= last_row; ++r) {
+      if (std::fabs(at(r, k)) > std::fabs(at(p, k))) p = r;
+    }
+    pivots[k] = p;
+    if (at(p, k) == 0) return false;
+    if (p != k) {
+      std::swap_ranges(&at(k, k), &at(k, last_col) + 1, &at(p, k));
+      odd = !odd;
+    }
+    const double* pivot = &at(k, k);
+    S21ThreadPool::Instance().ParallelFor(
+        k + 1, last_row + 1, last_col - k, [&](int lo, int hi) {
+          for (int r = lo; r < hi; ++r) {
+            double* a = &at(r, k);  // a[t] is element (r, k + t)
+            const double l = a[0] /= pivot[0];
+            for (int t = 1; t <= last_col - k; ++t) a[t] -= l * pivot[t];
+          }
+        });
+  }
+  return true;
+}
+
+S21Matrix S21BandMatrix::Solve(const S21Matrix& b) const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("Solve: the matrix is not square");
+  }
+  if (b.get_Row() != rows_) {
+    throw std::invalid_argument("Solve: incorrect right-hand side size");
+  }
+  std::vector<double> lu;
+  std::vector<int> pivots;
+  bool odd;
+  if (!Factor(lu, pivots, odd)) {
+    throw std::logic_error("Solve: the matrix is singular");
+  }
+  const int n = rows_;
+  const int lw = 2 * kl_ + ku_ + 1;
+  auto at = [&](int i, int j) -> const double& {
+    return lu[std::size_t(i) * lw + (j - i + kl_)];
+  };
+  S21Matrix x = b;
+  const int m = b.get_Col();
+  S21ThreadPool::Instance().ParallelFor(0, m, long(n) * lw,
+                                        [&](int lo, int hi) {
+    for (int k = 0; k < n; ++k) {
+      double* xk = x.data(k);
+      if (pivots[k] != k) {
+        std::swap_ranges(xk + lo, xk + hi, x.data(pivots[k]) + lo);
+      }
+      const int last_row = std::min(n - 1, k + kl_);
+      for (int r = k + 1; r <= last_row; ++r) {
+        const double l = at(r, k);
+        double* xr = x.data(r);
+        for (int c = lo; c < hi; ++c) xr[c] -= l * xk[c];
+      }
+    }
+    for (int i = n - 1; i >= 0; --i) {
+      double* xi = x.data(i);
+      const int last_col = std::min(n - 1, i + kl_ + ku_);
+      for (int j = i + 1; j <= last_col; ++j) {
+        const double u = at(i, j);
+        const double* xj = x.data(j);
+        for (int c = lo; c < hi; ++c) xi[c] -= u * xj[c];
+      }
+      for (int c = lo; c < hi; ++c) xi[c] /= at(i, i);
+    }
+  });
+  return x;
+}
+
+double S21BandMatrix::Determinant() const {
+  if (rows_ != cols_) {
+    throw std::invalid_argument("Determinant: the matrix is not square");
+  }
+  std::vector<double> lu;
+  std::vector<int> pivots;
+  bool odd;
+  if (!Factor(lu, pivots, odd)) return 0;
+  const int lw = 2 * kl_ + ku_ + 1;
+  double res = odd ? -1 : 1;
+  for (int i = 0; i < rows_; ++i) res *= lu[std::size_t(i) * lw + kl_];
+  return res;
+}
+
+int S21BandMatrix::get_Row() const { return rows_; }
+
+int S21BandMatrix::get_Col() const { return cols_; }
+
+int S21BandMatrix::get_Lower() const { return kl_; }
+
+int S21BandMatrix::get_Upper() const { return ku_; }
+
+std::size_t S21BandMatrix::Elements() const { return band_.size(); }
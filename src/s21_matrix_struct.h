@@ -0,0 +1,101 @@
+#ifndef __S21_MATRIX_STRUCT_H__
+#define __S21_MATRIX_STRUCT_H__
+
+#include <vector>
+
+#include "s21_matrix_oop.h"
+
+// Shape of the nonzeros of a dense matrix: entries below the kl-th
+// subdiagonal and above the ku-th superdiagonal are all zero.
+struct S21Structure {
+  bool square;
+  bool symmetric;
+  int kl, ku;
+
+  bool Upper() const { return kl == 0; }
+  bool Lower() const { return ku == 0; }
+  bool Diagonal() const { return kl == 0 && ku == 0; }
+
+  // entries with |x| <= eps count as zero, |a(i, j) - a(j, i)| <= eps as
+  // symmetric; one parallel pass over the rows
+  static S21Structure Detect(const S21Matrix& m, const double eps = 0);
+};
+
+// n x n symmetric or triangular matrix storing one triangle, n(n+1)/2
+// elements. Rows of the stored triangle are contiguous: row i of a lower
+// (or symmetric) matrix holds columns 0..i, row i of an upper one holds
+// columns i..n-1.
+class S21PackedMatrix {
+ public:
+  enum class Kind { kSymmetric, kLower, kUpper };
+
+  S21PackedMatrix(int n, Kind kind);
+  // takes the triangle the kind stores, the rest of m is ignored
+  static S21PackedMatrix FromDense(const S21Matrix& m, Kind kind);
+  S21Matrix ToDense() const;
+
+  // the structural zeros of a triangular matrix read as 0, at() throws
+  // std::out_of_range for them; both halves of a symmetric matrix alias the
+  // stored one
+  double operator()(int row, int col) const;
+  double& at(int row, int col);
+
+  // this * b touching only the stored triangle
+  S21Matrix MulMatrix(const S21Matrix& b) const;
+  // x with this * x = b by substitution, triangular kinds only
+  S21Matrix Solve(const S21Matrix& b) const;
+  // product of the diagonal, or LDL^T with Bunch-Kaufman pivoting on a
+  // packed copy for the symmetric kind
+  double Determinant() const;
+
+  int get_Size() const;
+  Kind get_Kind() const;
+  std::size_t Elements() const;
+
+ private:
+  std::size_t Index(int row, int col) const noexcept;  // in the triangle
+  bool Stored(int row, int col) const noexcept;
+
+  int n_;
+  Kind kind_;
+  std::vector<double> packed_;
+};
+
+// rows x cols matrix with kl subdiagonals and ku superdiagonals. Every row
+// keeps kl + ku + 1 slots, row i slot k holding column i - kl + k, so the
+// storage is O(rows * bandwidth).
+class S21BandMatrix {
+ public:
+  S21BandMatrix(int rows, int cols, int kl, int ku);
+  // takes the band of m, entries outside it are ignored
+  static S21BandMatrix FromDense(const S21Matrix& m, int kl, int ku);
+  S21Matrix ToDense() const;
+
+  // entries outside the band read as 0, at() throws std::out_of_range
+  double operator()(int row, int col) const;
+  double& at(int row, int col);
+
+  // this * b, O(rows * bandwidth * b.cols)
+  S21Matrix MulMatrix(const S21Matrix& b) const;
+  // x with this * x = b, banded LU with partial pivoting
+  S21Matrix Solve(const S21Matrix& b) const;
+  double Determinant() const;
+
+  int get_Row() const;
+  int get_Col() const;
+  int get_Lower() const;
+  int get_Upper() const;
+  std::size_t Elements() const;
+
+ private:
+  // LU factors in band storage with ku + kl superdiagonals for the fill-in
+  // of row interchanges; false if the matrix is singular
+  bool Factor(std::vector<double>& lu, std::vector<int>& pivots,
+              bool& odd) const;
+  bool InBand(int row, int col) const noexcept;
+
+  int rows_, cols_, kl_, ku_;
+  std::vector<double> band_;  // rows_ x (kl_ + ku_ + 1)
+};
+
+#endif
@@ -0,0 +1,223 @@
+#include "s21_matrix_tiled.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "s21_parallel.h"
+
+namespace {
+
+// Spreads the bits of x apart so that bit k lands on bit 2k.
+std::uint64_t Spread(std::uint32_t v) {
+  std::uint64_t x = v;
+  x = (x | x << 16) & 0x0000FFFF0000FFFFull;
+  x = (x | x << 8) & 0x00FF00FF00FF00FFull;
+  x = (x | x << 4) & 0x0F0F0F0F0F0F0F0Full;
+  x = (x | x << 2) & 0x3333333333333333ull;
+  x = (x | x << 1) & 0x5555555555555555ull;
+  return x;
+}
+
+std::uint64_t Morton(const int row, const int col) {
+  return Spread(row) << 1 | Spread(col);
+}
+
+}  // namespace
+
+S21TiledMatrix::S21TiledMatrix(int rows, int cols, Order order, int tile)
+    : rows_(rows), cols_(cols), order_(order), tile_(tile), shift_(0) {
+  if (rows < 1 || cols < 1 || tile < 1 || (tile & (tile - 1)) != 0) {
+    throw std::invalid_argument("Invalid argument");
+  }
+  while ((1 << shift_) < tile) ++shift_;
+  tile_rows_ = (rows + tile - 1) / tile;
+  tile_cols_ = (cols + tile - 1) / tile;
+  const int blocks = tile_rows_ * tile_cols_;
+  block_.resize(blocks);
+  for (int b = 0; b < blocks; ++b) block_[b] = b;
+  if (order == Order::kMorton) {
+    // ranks along the Z curve, so a grid that is not a power of two square
+    // does not leave holes in the storage
+    std::sort(block_.begin(), block_.end(), [this](int x, int y) {
+      return Morton(x / tile_cols_, x % tile_cols_) <
+             Morton(y / tile_cols_, y % tile_cols_);
+    });
+  }
+  slot_.resize(blocks);
+  for (int p = 0; p < blocks; ++p) slot_[block_[p]] = p;
+  data_.assign(std::size_t(blocks) << (2 * shift_), 0.0);
+}
+
+S21TiledMatrix::S21TiledMatrix(const S21Matrix& m, Order order, int tile)
+    : S21TiledMatrix(m.get_Row(), m.get_Col(), order, tile) {
+  const int blocks = tile_rows_ * tile_cols_;
+  S21ThreadPool::Instance().ParallelFor(
+      0, blocks, long(tile_) * tile_, [&](int lo, int hi) {
+        for (int p = lo; p < hi; ++p) {
+          const Tile t = TileAt(p);
+          for (int r = 0; r < t.rows; ++r) {
+            const double* src = m.data(t.row + r) + t.col;
+            std::copy(src, src + t.cols, t.data + r * t.stride);
+          }
+        }
+      });
+}
+
+S21Matrix S21TiledMatrix::ToDense() const {
+  S21Matrix res(rows_, cols_);
+  const int blocks = tile_rows_ * tile_cols_;
+  S21ThreadPool::Instance().ParallelFor(
+      0, blocks, long(tile_) * tile_, [&](int lo, int hi) {
+        for (int p = lo; p < hi; ++p) {
+          const ConstTile t = TileAt(p);
+          for (int r = 0; r < t.rows; ++r) {
+            const double* src = t.data + r * t.stride;
+            std::copy(src, src + t.cols, res.data(t.row + r) + t.col);
+          }
+        }
+      });
+  return res;
+}
+
+std::size_t S21TiledMatrix::Offset(int row, int col) const noexcept {
+  const int mask = tile_ - 1;
+  const std::size_t block =
+      slot_[(row >> shift_) * tile_cols_ + (col >> shift_)];
+  return (block << (2 * shift_)) + ((row & mask) << shift_) + (col & mask);
+}
+
+double& S21TiledMatrix::operator()(int row, int col) {
+  if (row < 0 || row >= rows_) {
+    throw std::out_of_range("Incorrect input, row is out of range");
+  }
+  if (col < 0 || col >= cols_) {
+    throw std::out_of_range("Incorrect input, col is out of range");
+  }
+  return data_[Offset(row, col)];
+}
+
+double S21TiledMatrix::operator()(int row, int col) const {
+  if (row < 0 || row >= rows_) {
+    throw std::out_of_range("Incorrect input, row is out of range");
+  }
+  if (col < 0 || col >= cols_) {
+    throw std::out_of_range("Incorrect input, col is out of range");
+  }
+  return data_[Offset(row, col)];
+}
+
+S21TiledMatrix::Tile S21TiledMatrix::TileAt(int pos) {
+  const ConstTile t = static_cast<const S21TiledMatrix&>(*this).TileAt(pos);
+  return Tile{t.row, t.col, t.rows, t.cols, t.stride,
+              data_.data() + (std::size_t(pos) << (2 * shift_))};
+}
+
+S21TiledMatrix::ConstTile S21TiledMatrix::TileAt(int pos) const {
+  const int row = block_[pos] / tile_cols_ * tile_;
+  const int col = block_[pos] % tile_cols_ * tile_;
+  return ConstTile{row,
+                   col,
+                   std::min(tile_, rows_ - row),
+                   std::min(tile_, cols_ - col),
+                   tile_,
+                   data_.data() + (std::size_t(pos) << (2 * shift_))};
+}
+
+S21TiledMatrix::Tile S21TiledMatrix::tile(int tile_row, int tile_col) {
+  if (tile_row < 0 || tile_row >= tile_rows_ || tile_col < 0 ||
+      tile_col >= tile_cols_) {
+    throw std::out_of_range("Incorrect input, tile is out of range");
+  }
+  return TileAt(slot_[tile_row * tile_cols_ + tile_col]);
+}
+
+S21TiledMatrix::ConstTile S21TiledMatrix::tile(int tile_row,
+                                               int tile_col) const {
+  if (tile_row < 0 || tile_row >= tile_rows_ || tile_col < 0 ||
+      tile_col >= tile_cols_) {
+    throw std::out_of_range("Incorrect input, tile is out of range");
+  }
+  return TileAt(slot_[tile_row * tile_cols_ + tile_col]);
+}
+
+S21TiledMatrix::TileIterator S21TiledMatrix::begin() {
+  return TileIterator(this, 0);
+}
+
+S21TiledMatrix::TileIterator S21TiledMatrix::end() {
+  return TileIterator(this, tile_rows_ * tile_cols_);
+}
+
+S21TiledMatrix::ConstTileIterator S21TiledMatrix::begin() const {
+  return ConstTileIterator(this, 0);
+}
+
+S21TiledMatrix::ConstTileIterator S21TiledMatrix::end() const {
+  return ConstTileIterator(this, tile_rows_ * tile_cols_);
+}
+
+S21TiledMatrix S21TiledMatrix::Transpose() const {
+  S21TiledMatrix res(cols_, rows_, order_, tile_);
+  const int blocks = tile_rows_ * tile_cols_;
+  // partitioned by output blocks, the ones each worker writes
+  S21ThreadPool::Instance().ParallelFor(
+      0, blocks, long(tile_) * tile_, [&](int lo, int hi) {
+        for (int p = lo; p < hi; ++p) {
+          const Tile out = res.TileAt(p);
+          const ConstTile in = TileAt(
+              slot_[(out.col >> shift_) * tile_cols_ + (out.row >> shift_)]);
+          for (int r = 0; r < in.rows; ++r) {
+            for (int c = 0; c < in.cols; ++c) {
+              out.data[c * out.stride + r] = in.data[r * in.stride + c];
+            }
+          }
+        }
+      });
+  return res;
+}
+
+S21TiledMatrix S21TiledMatrix::MulMatrix(const S21TiledMatrix& o) const {
+  if (cols_ != o.rows_) {
+    throw std::invalid_argument("MulMatrix: cannot multiply matrices");
+  }
+  if (tile_ != o.tile_) {
+    throw std::invalid_argument("MulMatrix: tile sizes differ");
+  }
+  S21TiledMatrix res(rows_, o.cols_, order_, tile_);
+  const int t = tile_;
+  const long cost = long(t) * t * t * tile_cols_;
+  S21ThreadPool::Instance().ParallelFor(
+      0, res.tile_rows_ * res.tile_cols_, cost, [&](int lo, int hi) {
+        for (int p = lo; p < hi; ++p) {
+          const Tile c = res.TileAt(p);
+          const int ti = c.row >> shift_;
+          const int tj = c.col >> shift_;
+          for (int k = 0; k < tile_cols_; ++k) {
+            const ConstTile a = TileAt(slot_[ti * tile_cols_ + k]);
+            const ConstTile b = o.TileAt(o.slot_[k * o.tile_cols_ + tj]);
+            // padding is zero, so full-width rows are safe and vectorize
+            for (int i = 0; i < a.rows; ++i) {
+              double* crow = c.data + i * t;
+              for (int x = 0; x < a.cols; ++x) {
+                const double aix = a.data[i * t + x];
+                const double* brow = b.data + x * t;
+                for (int j = 0; j < t; ++j) crow[j] += aix * brow[j];
+              }
+            }
+          }
+        }
+      });
+  return res;
+}
+
+int S21TiledMatrix::get_Row() const { return rows_; }
+
+int S21TiledMatrix::get_Col() const { return cols_; }
+
+int S21TiledMatrix::get_Tile() const { return tile_; }
+
+S21TiledMatrix::Order S21TiledMatrix::get_Order() const { return order_; }
+
+int S21TiledMatrix::TileRows() const { return tile_rows_; }
+
+int S21TiledMatrix::TileCols() const { return tile_cols_; }
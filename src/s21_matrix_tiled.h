@@ -0,0 +1,108 @@
+#ifndef __S21_MATRIX_TILED_H__
+#define __S21_MATRIX_TILED_H__
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "s21_matrix_oop.h"
+
+// Matrix stored as tile x tile blocks, each block contiguous and row-major
+// inside. Blocks follow each other row by row (kBlockMajor) or along a
+// Z-order curve (kMorton), which keeps neighbouring blocks in both
+// directions close in memory. Edge blocks are padded to full size.
+class S21TiledMatrix {
+ public:
+  enum class Order { kBlockMajor, kMorton };
+
+  // view of one block; element (r, c) of the block, r < rows and c < cols,
+  // is data[r * stride + c] and stands for (row + r, col + c)
+  template <class T>
+  struct BasicTile {
+    int row, col;
+    int rows, cols;
+    int stride;
+    T* data;
+  };
+  using Tile = BasicTile<double>;
+  using ConstTile = BasicTile<const double>;
+
+  // visits the blocks in storage order
+  template <class T, class M>
+  class BasicTileIterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = BasicTile<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = BasicTile<T>;
+
+    BasicTileIterator(M* m, int pos) : m_(m), pos_(pos) {}
+    BasicTile<T> operator*() const { return m_->TileAt(pos_); }
+    BasicTileIterator& operator++() {
+      ++pos_;
+      return *this;
+    }
+    bool operator==(const BasicTileIterator& o) const {
+      return pos_ == o.pos_;
+    }
+    bool operator!=(const BasicTileIterator& o) const {
+      return pos_ != o.pos_;
+    }
+
+   private:
+    M* m_;
+    int pos_;
+  };
+  using TileIterator = BasicTileIterator<double, S21TiledMatrix>;
+  using ConstTileIterator =
+      BasicTileIterator<const double, const S21TiledMatrix>;
+
+  static constexpr int kDefaultTile = 64;  // 32 KiB per block
+
+  // tile must be a power of two
+  S21TiledMatrix(int rows, int cols, Order order = Order::kMorton,
+                 int tile = kDefaultTile);
+  // converts in parallel, one block per task
+  explicit S21TiledMatrix(const S21Matrix& m, Order order = Order::kMorton,
+                          int tile = kDefaultTile);
+  S21Matrix ToDense() const;
+
+  double& operator()(int row, int col);
+  double operator()(int row, int col) const;
+
+  Tile tile(int tile_row, int tile_col);
+  ConstTile tile(int tile_row, int tile_col) const;
+  TileIterator begin();
+  TileIterator end();
+  ConstTileIterator begin() const;
+  ConstTileIterator end() const;
+
+  // block by block: every block is read once and written once, as a whole
+  S21TiledMatrix Transpose() const;
+  // block GEMM, o must have the same tile size; the result takes the order
+  // of this
+  S21TiledMatrix MulMatrix(const S21TiledMatrix& o) const;
+
+  int get_Row() const;
+  int get_Col() const;
+  int get_Tile() const;
+  Order get_Order() const;
+  int TileRows() const;
+  int TileCols() const;
+
+ private:
+  Tile TileAt(int pos);
+  ConstTile TileAt(int pos) const;
+  std::size_t Offset(int row, int col) const noexcept;
+
+  int rows_, cols_;
+  Order order_;
+  int tile_, shift_;
+  int tile_rows_, tile_cols_;
+  std::vector<int> slot_;   // storage position of block tr * tile_cols_ + tc
+  std::vector<int> block_;  // block at a storage position, slot_ inverted
+  std::vector<double> data_;
+};
+
+#endif
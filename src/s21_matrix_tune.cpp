@@ -0,0 +1,531 @@
+#include "s21_matrix_tune.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <utility>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+#include "s21_parallel.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Key = std::array<int, 3>;
+
+// Products below this many multiply-adds are never tuned on first use.
+constexpr long kFirstUseWork = 1L << 18;
+// A measurement repeats the operation for at least this long.
+constexpr double kMinTiming = 1e-3;
+// Shapes are tuned, on first use and by Tune, on operands capped at these
+// sizes: large enough for every candidate panel, small enough to stay cheap.
+constexpr int kProxyRows = 256;
+constexpr int kProxyCols = 1024;
+
+struct Field {
+  const char* name;
+  int S21KernelParams::*member;
+};
+
+constexpr Field kFields[] = {
+    {"mul_block_rows", &S21KernelParams::mul_block_rows},
+    {"mul_block_depth", &S21KernelParams::mul_block_depth},
+    {"mul_block_cols", &S21KernelParams::mul_block_cols},
+    {"mul_unroll", &S21KernelParams::mul_unroll},
+    {"mul_blocked_min", &S21KernelParams::mul_blocked_min},
+    {"transpose_block", &S21KernelParams::transpose_block},
+};
+// the fields a shape entry carries, in the order they are tuned
+constexpr int kShapeFields = 4;
+
+// Parameters as one immutable table. Writers copy the current table,
+// change the copy and publish it under mu; readers keep a per-thread
+// reference to the table and take mu only after a write has bumped the
+// version, so kernels never contend on the lock.
+struct Table {
+  S21KernelParams defaults;
+  std::vector<std::pair<Key, S21KernelParams>> shapes;  // sorted by key
+
+  const S21KernelParams* Find(const Key& key) const {
+    const auto it = std::lower_bound(
+        shapes.begin(), shapes.end(), key,
+        [](const std::pair<Key, S21KernelParams>& e, const Key& k) {
+          return e.first < k;
+        });
+    return it != shapes.end() && it->first == key ? &it->second : nullptr;
+  }
+
+  void Set(const Key& key, const S21KernelParams& params) {
+    const auto it = std::lower_bound(
+        shapes.begin(), shapes.end(), key,
+        [](const std::pair<Key, S21KernelParams>& e, const Key& k) {
+          return e.first < k;
+        });
+    if (it != shapes.end() && it->first == key) {
+      it->second = params;
+    } else {
+      shapes.insert(it, {key, params});
+    }
+  }
+};
+
+struct State {
+  std::mutex mu;  // serializes writers and guards table and tuning
+  std::shared_ptr<const Table> table = std::make_shared<Table>();
+  std::atomic<std::uint64_t> version{0};
+  std::atomic<double> first_use_left{0};
+  std::set<Key> tuning;  // shapes being tuned on first use
+
+  static State& Get() {
+    static State* state = new State();  // kernels may run at exit
+#ifdef __linux__
+    // a fork while another thread holds mu would leave it locked for good
+    // in the child
+    static const bool registered =
+        pthread_atfork([] { state->mu.lock(); }, [] { state->mu.unlock(); },
+                       [] { state->mu.unlock(); }) == 0;
+    (void)registered;
+#endif
+    return *state;
+  }
+
+  // the current table; lock-free unless it changed since this thread
+  // last looked
+  const Table& Current() {
+    thread_local std::shared_ptr<const Table> cached;
+    thread_local std::uint64_t seen = 0;
+    if (!cached || version.load(std::memory_order_acquire) != seen) {
+      std::lock_guard<std::mutex> lock(mu);
+      cached = table;
+      seen = version.load(std::memory_order_relaxed);
+    }
+    return *cached;
+  }
+
+  // applies edit to a copy of the table and publishes it; mu must be held
+  template <class F>
+  void Update(F&& edit) {
+    std::shared_ptr<Table> next = std::make_shared<Table>(*table);
+    edit(*next);
+    table = std::move(next);
+    version.fetch_add(1, std::memory_order_release);
+  }
+};
+
+int Bucket(const int v) {
+  int b = 1;
+  while (b < v) b <<= 1;
+  return b;
+}
+
+Key KeyOf(const int m, const int n, const int k) {
+  return Key{Bucket(m), Bucket(n), Bucket(k)};
+}
+
+S21KernelParams Merge(S21KernelParams defaults,
+                      const S21KernelParams& shape) {
+  for (int f = 0; f < kShapeFields; ++f) {
+    defaults.*kFields[f].member = shape.*kFields[f].member;
+  }
+  return defaults;
+}
+
+double Since(const Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// seconds per call, best of three runs
+template <class F>
+double Time(F&& fn) {
+  double best = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < 3; ++run) {
+    const Clock::time_point start = Clock::now();
+    int calls = 0;
+    double elapsed = 0;
+    do {
+      fn();
+      ++calls;
+      elapsed = Since(start);
+    } while (elapsed < kMinTiming);
+    best = std::min(best, elapsed / calls);
+  }
+  return best;
+}
+
+S21Matrix Filled(const int rows, const int cols) {
+  S21Matrix m(rows, cols);
+  unsigned state = 12345;
+  for (int i = 0; i < rows; ++i) {
+    double* row = m.data(i);
+    for (int j = 0; j < cols; ++j) {
+      state = state * 1664525u + 1013904223u;
+      row[j] = (state >> 8) / 16777216.0 - 0.5;
+    }
+  }
+  return m;
+}
+
+// Coordinate descent over the fields in [first, last): each field in turn
+// takes its fastest candidate with the others held. Stops at the deadline
+// with the best parameters found so far.
+template <class F>
+S21KernelParams Descend(S21KernelParams best, const int first, const int last,
+                        const Clock::time_point deadline, F&& measure) {
+  static const std::vector<int> kCandidates[] = {
+      {8, 16, 32, 64, 128},    {64, 128, 256, 512},
+      {128, 256, 512, 1024},   {1, 2, 4},
+      {16, 32, 64, 128, 256},  {8, 16, 32, 64, 128},
+  };
+  double best_time = measure(best);
+  for (int f = first; f < last; ++f) {
+    const int current = best.*kFields[f].member;
+    for (const int value : kCandidates[f]) {
+      if (value == current) continue;
+      if (Clock::now() >= deadline) return best;
+      S21KernelParams candidate = best;
+      candidate.*kFields[f].member = value;
+      const double t = measure(candidate);
+      if (t < best_time) {
+        best_time = t;
+        best = candidate;
+      }
+    }
+  }
+  return best;
+}
+
+S21KernelParams TuneMul(const int m, const int n, const int k,
+                        const S21KernelParams& start,
+                        const Clock::time_point deadline) {
+  const S21Matrix a = Filled(m, k);
+  const S21Matrix b = Filled(k, n);
+  S21Matrix c(m, n);
+  return Descend(start, 0, kShapeFields, deadline,
+                 [&](S21KernelParams p) {
+                   p.mul_blocked_min = 0;
+                   return Time([&] { S21Matrix::MulInto(a, b, c, p); });
+                 });
+}
+
+// smallest tried size from which the blocked kernel is at least as fast
+int TuneCrossover(const S21KernelParams& params,
+                  const Clock::time_point deadline) {
+  S21KernelParams plain = params;
+  plain.mul_blocked_min = std::numeric_limits<int>::max();
+  S21KernelParams blocked = params;
+  blocked.mul_blocked_min = 0;
+  for (int n = 16; n <= 256; n *= 2) {
+    if (Clock::now() >= deadline) return params.mul_blocked_min;
+    const S21Matrix a = Filled(n, n);
+    S21Matrix c(n, n);
+    const double t_plain =
+        Time([&] { S21Matrix::MulInto(a, a, c, plain); });
+    const double t_blocked =
+        Time([&] { S21Matrix::MulInto(a, a, c, blocked); });
+    if (t_blocked <= t_plain) return n;
+  }
+  return 512;
+}
+
+// smallest amount of work a parallel elementwise pass is worth waking the
+// workers for. The pass (that of MulNumber) is timed with explicit
+// thresholds, so kernels of other threads keep the installed one.
+long TuneParallelWork(const long current, const Clock::time_point deadline) {
+  S21ThreadPool& pool = S21ThreadPool::Instance();
+  if (pool.Workers() < 2) return current;
+  for (long work = 1L << 12; work <= 1L << 20; work <<= 2) {
+    if (Clock::now() >= deadline) break;
+    const int side = static_cast<int>(std::sqrt(double(work)));
+    S21Matrix m = Filled(side, side);
+    auto scale = [&](const long min_work) {
+      pool.ParallelFor(0, side, side, min_work, [&](int lo, int hi) {
+        for (int i = lo; i < hi; ++i) {
+          double* row = m.data(i);
+          for (int j = 0; j < side; ++j) row[j] *= 1.0;
+        }
+      });
+    };
+    const double serial =
+        Time([&] { scale(std::numeric_limits<long>::max()); });
+    const double parallel = Time([&] { scale(0); });
+    if (parallel < serial) return work;
+  }
+  return current;
+}
+
+const Field* FindField(const std::string& name) {
+  for (const Field& f : kFields) {
+    if (name == f.name) return &f;
+  }
+  return nullptr;
+}
+
+[[noreturn]] void Malformed(const int line, const std::string& what) {
+  throw std::invalid_argument("Parse: line " + std::to_string(line) + ": " +
+                              what);
+}
+
+// reads "key value" pairs from the rest of the line into params
+void ReadPairs(std::istringstream& in, const int line, const bool shape,
+               S21KernelParams& params) {
+  std::string key;
+  while (in >> key) {
+    long value = 0;
+    if (!(in >> value)) Malformed(line, "missing value for " + key);
+    if (!shape && key == "parallel_work") {
+      params.parallel_work = value;
+      continue;
+    }
+    const Field* f = FindField(key);
+    if (f == nullptr || (shape && f >= kFields + kShapeFields)) {
+      Malformed(line, "unknown key " + key);
+    }
+    if (value < std::numeric_limits<int>::min() ||
+        value > std::numeric_limits<int>::max()) {
+      Malformed(line, key + " out of range");
+    }
+    params.*f->member = static_cast<int>(value);
+  }
+}
+
+void LoadFromEnvironment() {
+  const char* path = std::getenv("S21_MATRIX_PROFILE");
+  if (path == nullptr || *path == '\0') return;
+  try {
+    S21Tuner::Load(path);
+  } catch (const std::exception&) {
+    // an unusable profile leaves the built-in parameters in place
+  }
+}
+
+const bool loaded_at_startup = (LoadFromEnvironment(), true);
+
+}  // namespace
+
+S21KernelParams S21Tuner::Defaults() {
+  return State::Get().Current().defaults;
+}
+
+S21KernelParams S21Tuner::ForMul(const int m, const int n,
+                                 const int k) noexcept {
+  State& st = State::Get();
+  const Table& table = st.Current();
+  const Key key = KeyOf(m, n, k);
+  if (const S21KernelParams* shape = table.Find(key)) {
+    return Merge(table.defaults, *shape);
+  }
+  if (st.first_use_left.load(std::memory_order_relaxed) <= 0 ||
+      long(m) * n * k < kFirstUseWork || S21ThreadPool::InWorker()) {
+    return table.defaults;
+  }
+  S21KernelParams start;
+  double budget = 0;
+  {
+    std::lock_guard<std::mutex> lock(st.mu);
+    if (const S21KernelParams* shape = st.table->Find(key)) {
+      return Merge(st.table->defaults, *shape);  // tuned meanwhile
+    }
+    start = st.table->defaults;
+    budget = st.first_use_left.load(std::memory_order_relaxed);
+    try {
+      // claims the shape, so concurrent products of it do not tune it again
+      if (budget <= 0 || !st.tuning.insert(key).second) return start;
+    } catch (const std::exception&) {
+      return start;
+    }
+  }
+  // tuning runs without the lock; other threads keep reading the old table
+  const Clock::time_point begin = Clock::now();
+  S21KernelParams tuned = start;
+  try {
+    tuned = TuneMul(std::min(m, kProxyRows), std::min(n, kProxyCols),
+                    std::min(k, kProxyCols), start,
+                    begin + std::chrono::duration_cast<Clock::duration>(
+                                std::chrono::duration<double>(budget)));
+  } catch (const std::exception&) {
+    // out of memory for the proxy operands: keep the defaults
+  }
+  const double spent = Since(begin);
+  std::lock_guard<std::mutex> lock(st.mu);
+  st.first_use_left.store(
+      std::max(0.0, st.first_use_left.load(std::memory_order_relaxed) -
+                        spent),
+      std::memory_order_relaxed);
+  st.tuning.erase(key);
+  try {
+    st.Update([&](Table& t) { t.Set(key, tuned); });
+  } catch (const std::exception&) {
+    // not recorded; the shape is tuned again on its next use
+  }
+  return Merge(st.table->defaults, tuned);
+}
+
+void S21Tuner::SetDefaults(const S21KernelParams& params) {
+  Validate(params);
+  State& st = State::Get();
+  std::lock_guard<std::mutex> lock(st.mu);
+  st.Update([&](Table& t) { t.defaults = params; });
+  S21ThreadPool::SetParallelWork(params.parallel_work);
+}
+
+void S21Tuner::SetMul(const int m, const int n, const int k,
+                      const S21KernelParams& params) {
+  if (m < 1 || n < 1 || k < 1) {
+    throw std::invalid_argument("SetMul: invalid shape");
+  }
+  Validate(params);
+  State& st = State::Get();
+  std::lock_guard<std::mutex> lock(st.mu);
+  st.Update([&](Table& t) { t.Set(KeyOf(m, n, k), params); });
+}
+
+void S21Tuner::Reset() {
+  State& st = State::Get();
+  std::lock_guard<std::mutex> lock(st.mu);
+  st.Update([](Table& t) { t = Table(); });
+  st.first_use_left.store(0, std::memory_order_relaxed);
+  S21ThreadPool::SetParallelWork(S21KernelParams().parallel_work);
+}
+
+void S21Tuner::Validate(const S21KernelParams& params) {
+  if (params.mul_block_rows < 1 || params.mul_block_depth < 1 ||
+      params.mul_block_cols < 1 || params.transpose_block < 1) {
+    throw std::invalid_argument("Validate: block sizes must be positive");
+  }
+  if (params.mul_unroll != 1 && params.mul_unroll != 2 &&
+      params.mul_unroll != 4) {
+    throw std::invalid_argument("Validate: mul_unroll must be 1, 2 or 4");
+  }
+  if (params.mul_blocked_min < 0 || params.parallel_work < 0) {
+    throw std::invalid_argument("Validate: thresholds must not be negative");
+  }
+}
+
+void S21Tuner::Load(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  std::stringstream text;
+  text << in.rdbuf();
+  if (in.bad()) {
+    throw std::runtime_error("cannot read " + path);
+  }
+  Parse(text.str());
+}
+
+void S21Tuner::Parse(std::string_view text) {
+  S21KernelParams defaults;
+  std::map<Key, S21KernelParams> shapes;
+  std::istringstream lines{std::string(text)};
+  std::string raw;
+  for (int line = 1; std::getline(lines, raw); ++line) {
+    const std::size_t hash = raw.find('#');
+    if (hash != std::string::npos) raw.resize(hash);
+    std::istringstream in(raw);
+    std::string word;
+    if (!(in >> word)) continue;
+    if (word == "mul") {
+      int m = 0, n = 0, k = 0;
+      if (!(in >> m >> n >> k) || m < 1 || n < 1 || k < 1) {
+        Malformed(line, "bad shape");
+      }
+      S21KernelParams params;
+      ReadPairs(in, line, true, params);
+      shapes[KeyOf(m, n, k)] = params;
+    } else {
+      std::istringstream pair(raw);
+      ReadPairs(pair, line, false, defaults);
+    }
+  }
+  Validate(defaults);
+  for (const auto& shape : shapes) Validate(shape.second);
+  State& st = State::Get();
+  std::lock_guard<std::mutex> lock(st.mu);
+  st.Update([&](Table& t) {
+    t.defaults = defaults;
+    t.shapes.assign(shapes.begin(), shapes.end());
+  });
+  S21ThreadPool::SetParallelWork(defaults.parallel_work);
+}
+
+void S21Tuner::Save(const std::string& path) {
+  const std::string text = Format();
+  std::ofstream out(path, std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("cannot create " + path);
+  }
+  out << text;
+  out.close();
+  if (!out) {
+    throw std::runtime_error("cannot write " + path);
+  }
+}
+
+std::string S21Tuner::Format() {
+  const Table& table = State::Get().Current();
+  std::ostringstream out;
+  out << "# s21_matrix kernel profile\n";
+  for (const Field& f : kFields) {
+    out << f.name << ' ' << table.defaults.*f.member << '\n';
+  }
+  out << "parallel_work " << table.defaults.parallel_work << '\n';
+  for (const auto& shape : table.shapes) {
+    out << "mul " << shape.first[0] << ' ' << shape.first[1] << ' '
+        << shape.first[2];
+    for (int f = 0; f < kShapeFields; ++f) {
+      out << ' ' << kFields[f].name << ' '
+          << shape.second.*kFields[f].member;
+    }
+    out << '\n';
+  }
+  return out.str();
+}
+
+void S21Tuner::Tune(const S21TuneOptions& options) {
+  const Clock::time_point deadline =
+      Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(options.budget));
+  S21KernelParams params = Defaults();
+  params = TuneMul(256, 256, 256, params, deadline);
+  params.mul_blocked_min = TuneCrossover(params, deadline);
+  {
+    const S21Matrix m = Filled(1024, 1024);
+    S21Matrix out(1024, 1024);
+    params = Descend(params, 5, 6, deadline, [&](const S21KernelParams& p) {
+      return Time([&] { m.TransposeInto(out, p); });
+    });
+  }
+  params.parallel_work = TuneParallelWork(params.parallel_work, deadline);
+  SetDefaults(params);
+  for (const Key& shape : options.shapes) {
+    if (Clock::now() >= deadline) break;
+    // on a proxy of capped size, as on first use
+    SetMul(shape[0], shape[1], shape[2],
+           TuneMul(std::min(shape[0], kProxyRows),
+                   std::min(shape[1], kProxyCols),
+                   std::min(shape[2], kProxyCols), params, deadline));
+  }
+}
+
+void S21Tuner::SetFirstUseBudget(const double seconds) {
+  State& st = State::Get();
+  std::lock_guard<std::mutex> lock(st.mu);
+  st.first_use_left.store(std::max(0.0, seconds), std::memory_order_relaxed);
+}
+
+double S21Tuner::FirstUseBudget() {
+  return State::Get().first_use_left.load(std::memory_order_relaxed);
+}
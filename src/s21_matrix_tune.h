@@ -0,0 +1,60 @@
+#ifndef __S21_MATRIX_TUNE_H__
+#define __S21_MATRIX_TUNE_H__
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "s21_matrix_oop.h"
+
+struct S21TuneOptions {
+  double budget = 10;  // seconds for the whole run
+  // {m, n, k} of m x k by k x n products tuned on their own, timed on
+  // operands capped at 256 rows and 1024 columns like first-use tuning
+  std::vector<std::array<int, 3>> shapes;
+};
+
+// Kernel auto-tuner. At startup the library loads the profile named by the
+// S21_MATRIX_PROFILE environment variable, if it is readable and well
+// formed, and keeps the built-in S21KernelParams otherwise. Products are
+// matched to per-shape entries by their dimensions rounded up to powers of
+// two; a shape entry overrides the mul_block_* and mul_unroll fields of the
+// defaults. All methods are thread-safe; Defaults and ForMul read a
+// published copy of the parameters without locking, and a shape tuned on
+// first use is published when its tuning finishes.
+class S21Tuner {
+ public:
+  static S21KernelParams Defaults();
+  // parameters for an m x k by k x n product; tunes the shape first when
+  // first-use tuning is on and the shape has not been seen yet
+  static S21KernelParams ForMul(const int m, const int n,
+                                const int k) noexcept;
+  static void SetDefaults(const S21KernelParams& params);
+  static void SetMul(const int m, const int n, const int k,
+                     const S21KernelParams& params);
+  // built-in parameters, no shape entries, first-use tuning off
+  static void Reset();
+  // throws std::invalid_argument when a field is out of range
+  static void Validate(const S21KernelParams& params);
+
+  // "key value" lines set the defaults, "mul m n k key value ..." lines add
+  // shape entries and '#' starts a comment. Load and Parse replace the whole
+  // state; malformed text throws std::invalid_argument naming the line, I/O
+  // errors throw std::runtime_error.
+  static void Load(const std::string& path);
+  static void Parse(std::string_view text);
+  static void Save(const std::string& path);
+  static std::string Format();
+
+  // times candidate block sizes, unroll factors, the blocked/plain crossover
+  // and the parallel threshold on this machine, then installs the fastest;
+  // overruns the budget by at most one measurement
+  static void Tune(const S21TuneOptions& options);
+  // products of unseen shapes are tuned on first use until seconds of
+  // tuning have been spent in total; 0 turns first-use tuning off
+  static void SetFirstUseBudget(const double seconds);
+  static double FirstUseBudget();  // seconds left
+};
+
+#endif
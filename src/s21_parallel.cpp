@@ -0,0 +1,288 @@
+#include "s21_parallel.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+thread_local bool in_worker = false;
+std::atomic<long> parallel_work{S21ThreadPool::kParallelWork};
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+std::vector<int> ParseCpuList(const std::string& text) {
+  std::vector<int> cpus;
+  std::stringstream ss(text);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty() || item == "\n") continue;
+    const std::size_t dash = item.find('-');
+    const int lo = std::atoi(item.substr(0, dash).c_str());
+    const int hi = dash == std::string::npos
+                       ? lo
+                       : std::atoi(item.substr(dash + 1).c_str());
+    for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+  }
+  return cpus;
+}
+
+bool CpuAllowed(const int cpu) {
+#ifdef __linux__
+  static cpu_set_t mask;
+  static const bool have_mask =
+      sched_getaffinity(0, sizeof(mask), &mask) == 0;
+  return !have_mask || cpu >= CPU_SETSIZE || CPU_ISSET(cpu, &mask);
+#else
+  (void)cpu;
+  return true;
+#endif
+}
+
+}  // namespace
+
+S21Topology::S21Topology() : node_count_(0) {
+  for (int node = 0;; ++node) {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist");
+    if (!in) {
+      if (node > 0) break;
+      // no sysfs topology: one node holding every cpu we may use
+      const int n = std::max(1u, std::thread::hardware_concurrency());
+      for (int c = 0; c < n; ++c) {
+        if (CpuAllowed(c)) {
+          cpus_.push_back(c);
+          nodes_.push_back(0);
+        }
+      }
+      node_count_ = 1;
+      break;
+    }
+    std::string text;
+    std::getline(in, text);
+    bool used = false;
+    for (int c : ParseCpuList(text)) {
+      if (CpuAllowed(c)) {
+        cpus_.push_back(c);
+        nodes_.push_back(node_count_);
+        used = true;
+      }
+    }
+    if (used) ++node_count_;  // memory-only nodes are skipped
+  }
+  if (cpus_.empty()) {
+    cpus_.push_back(-1);  // unknown cpu, never pinned
+    nodes_.push_back(0);
+    node_count_ = 1;
+  }
+}
+
+const S21Topology& S21Topology::Get() {
+  // never destroyed: pinned workers read it until the process exits
+  static const S21Topology* topology = new S21Topology();
+  return *topology;
+}
+
+int S21Topology::Nodes() const { return node_count_; }
+
+int S21Topology::Cpus() const { return static_cast<int>(cpus_.size()); }
+
+int S21Topology::CpuAt(const int index) const {
+  return cpus_[index % cpus_.size()];
+}
+
+int S21Topology::NodeOfCpu(const int index) const {
+  return nodes_[index % nodes_.size()];
+}
+
+S21ThreadPool& S21ThreadPool::Instance() {
+  static std::atomic<S21ThreadPool*> pool{nullptr};
+  static std::mutex mu;  // only taken until the pool exists
+  S21ThreadPool* p = pool.load(std::memory_order_acquire);
+  if (p != nullptr) return *p;
+  std::lock_guard<std::mutex> lock(mu);
+  p = pool.load(std::memory_order_relaxed);
+  if (p == nullptr) {
+    static bool forked = false;
+#ifdef __linux__
+    // A forked child inherits the pool object but not its threads, so it
+    // builds an inline pool on first use. Holding mu across fork keeps a
+    // pool under construction out of the child.
+    static const bool registered =
+        pthread_atfork([] { mu.lock(); }, [] { mu.unlock(); },
+                       [] {
+                         pool.store(nullptr, std::memory_order_relaxed);
+                         forked = true;
+                         mu.unlock();
+                       }) == 0;
+    (void)registered;
+#endif
+    int workers = S21Topology::Get().Cpus();
+    if (const char* env = std::getenv("S21_MATRIX_THREADS")) {
+      workers = std::max(1, std::atoi(env));
+    }
+    if (forked) workers = 0;
+    p = new S21ThreadPool(workers);
+    pool.store(p, std::memory_order_release);
+  }
+  return *p;
+}
+
+S21ThreadPool::S21ThreadPool(const int threads)
+    : generation_(0),
+      pending_(0),
+      idle_tasks_(0),
+      draining_(false),
+      task_(nullptr),
+      ctx_(nullptr),
+      parts_(0) {
+  const S21Topology& topo = S21Topology::Get();
+  const int workers = std::max(1, threads);
+  workers_on_node_.assign(topo.Nodes(), 0);
+  for (int p = 0; p < workers; ++p) {
+    // spread workers evenly over the cpu list, hence over the nodes
+    const int cpu = workers <= topo.Cpus()
+                        ? static_cast<int>(1L * p * topo.Cpus() / workers)
+                        : p % topo.Cpus();
+    const int node = topo.NodeOfCpu(cpu);
+    cpu_of_.push_back(cpu);
+    node_of_.push_back(node);
+    rank_on_node_.push_back(workers_on_node_[node]++);
+  }
+  std::vector<int> order(workers);
+  for (int p = 0; p < workers; ++p) order[p] = p;
+  std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+    return rank_on_node_[a] < rank_on_node_[b];
+  });
+  interleave_slot_.resize(workers);
+  for (int i = 0; i < workers; ++i) interleave_slot_[order[i]] = i;
+  for (int p = 0; p < threads; ++p) {
+    threads_.emplace_back(&S21ThreadPool::WorkerLoop, this, p);
+  }
+}
+
+int S21ThreadPool::Workers() const {
+  return static_cast<int>(cpu_of_.size());
+}
+
+bool S21ThreadPool::Inline() const { return threads_.empty(); }
+
+int S21ThreadPool::NodeOf(const int worker) const { return node_of_[worker]; }
+
+int S21ThreadPool::WorkersOnNode(const int node) const {
+  return workers_on_node_[node];
+}
+
+int S21ThreadPool::RankOnNode(const int worker) const {
+  return rank_on_node_[worker];
+}
+
+int S21ThreadPool::InterleaveSlot(const int worker) const {
+  return interleave_slot_[worker];
+}
+
+bool S21ThreadPool::InWorker() noexcept { return in_worker; }
+
+long S21ThreadPool::ParallelWork() noexcept {
+  return parallel_work.load(std::memory_order_relaxed);
+}
+
+void S21ThreadPool::SetParallelWork(const long work) noexcept {
+  parallel_work.store(work, std::memory_order_relaxed);
+}
+
+void S21ThreadPool::Run(const int parts, Task task, void* ctx) noexcept {
+  if (parts <= 0) return;
+  if (Inline()) {
+    task(ctx, 0);
+    return;
+  }
+  std::lock_guard<std::mutex> serial(run_mu_);
+  std::unique_lock<std::mutex> lock(mu_);
+  task_ = task;
+  ctx_ = ctx;
+  parts_ = std::min(parts, Workers());
+  pending_ = parts_;
+  ++generation_;
+  cv_.notify_all();
+  done_cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void S21ThreadPool::WorkerLoop(const int id) {
+  in_worker = true;
+#ifdef __linux__
+  const S21Topology& topo = S21Topology::Get();
+  const int cpu = topo.CpuAt(cpu_of_[id]);
+  if (cpu >= 0 && topo.Cpus() > 1) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+#endif
+  std::uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(mu_);
+  for (;;) {
+    cv_.wait(lock, [&] { return generation_ != seen; });
+    seen = generation_;
+    if (id >= parts_) continue;
+    Task task = task_;
+    void* ctx = ctx_;
+    lock.unlock();
+    task(ctx, id);
+    lock.lock();
+    if (--pending_ == 0) done_cv_.notify_one();
+  }
+}
+
+void S21ThreadPool::TaskLoop() {
+  std::unique_lock<std::mutex> lock(task_mu_);
+  for (;;) {
+    ++idle_tasks_;
+    task_cv_.wait(lock, [this] { return !tasks_.empty(); });
+    --idle_tasks_;
+    std::function<void()> task = std::move(tasks_.front());
+    tasks_.pop_front();
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+}
+
+void S21ThreadPool::Submit(std::function<void()> task) {
+  std::unique_lock<std::mutex> lock(task_mu_);
+  tasks_.push_back(std::move(task));
+  if (!Inline()) {
+    if (static_cast<int>(tasks_.size()) > idle_tasks_ &&
+        static_cast<int>(task_threads_.size()) < Workers()) {
+      try {
+        task_threads_.emplace_back(&S21ThreadPool::TaskLoop, this);
+      } catch (...) {
+        // the running threads get to the task eventually, if there are any
+        if (task_threads_.empty()) {
+          tasks_.pop_back();
+          throw;
+        }
+      }
+    }
+    task_cv_.notify_one();
+    return;
+  }
+  // the first submitter runs the queue, including what its tasks submit
+  if (draining_) return;
+  draining_ = true;
+  while (!tasks_.empty()) {
+    std::function<void()> next = std::move(tasks_.front());
+    tasks_.pop_front();
+    lock.unlock();
+    next();
+    lock.lock();
+  }
+  draining_ = false;
+}
@@ -0,0 +1,154 @@
+#ifndef __S21_PARALLEL_H__
+#define __S21_PARALLEL_H__
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// NUMA topology of the cpus this process may run on. Cpus are ordered node
+// by node, so contiguous worker ranges map onto contiguous nodes.
+class S21Topology {
+ public:
+  static const S21Topology& Get();
+
+  int Nodes() const;
+  int Cpus() const;
+  int CpuAt(const int index) const;
+  int NodeOfCpu(const int index) const;
+
+ private:
+  S21Topology();
+
+  std::vector<int> cpus_;   // allowed cpus, node-major order
+  std::vector<int> nodes_;  // node of cpus_[i]
+  int node_count_;
+};
+
+// Fixed pool of pinned workers. Worker p always runs part p of a job, so a
+// row range first-touched by ParallelFor is later processed by the thread
+// (and therefore the NUMA node) that owns its pages. Independent tasks are
+// queued for a separate set of task threads, started on demand up to one
+// per worker: a task is not a worker, so its ParallelFor calls still spread
+// over the workers, and queued tasks never hold up a job. A forked child
+// gets an inline pool of one worker and no threads, which runs jobs and
+// tasks in the calling thread: many runtimes, TSan among them, do not
+// support starting threads after a multithreaded fork.
+class S21ThreadPool {
+ public:
+  using Task = void (*)(void* ctx, int part);
+
+  static S21ThreadPool& Instance();
+
+  int Workers() const;
+  // no worker threads, see above
+  bool Inline() const;
+  int NodeOf(const int worker) const;
+  int WorkersOnNode(const int node) const;
+  int RankOnNode(const int worker) const;
+  // position of a worker in a node-alternating order of all workers
+  int InterleaveSlot(const int worker) const;
+  static bool InWorker() noexcept;
+
+  // runs task(ctx, p) on worker p for every p < parts and waits
+  void Run(const int parts, Task task, void* ctx) noexcept;
+
+  // queues an independent task for the next idle task thread; tasks must
+  // not throw and must not block on other queued tasks. An inline pool runs
+  // the task before Submit returns (after the task this thread is running,
+  // if any), so callers must not hold a lock the task takes.
+  void Submit(std::function<void()> task);
+
+  // static partition of [begin, end) into Workers() contiguous chunks;
+  // runs inline when the range is cheap or when called from a worker
+  template <class F>
+  void ParallelFor(const int begin, const int end, const long cost_per_item,
+                   F&& fn) noexcept;
+  // with an explicit threshold in place of ParallelWork()
+  template <class F>
+  void ParallelFor(const int begin, const int end, const long cost_per_item,
+                   const long min_work, F&& fn) noexcept;
+
+  // total work (in flops or touched elements) worth waking the workers for
+  static constexpr long kParallelWork = 1L << 16;
+  // the threshold ParallelFor applies; kParallelWork until a tuning profile
+  // says otherwise
+  static long ParallelWork() noexcept;
+  static void SetParallelWork(const long work) noexcept;
+
+ private:
+  // threads = 0 builds the inline pool
+  explicit S21ThreadPool(const int threads);
+  ~S21ThreadPool() = delete;  // workers live until the process exits
+  void WorkerLoop(const int id);
+  void TaskLoop();
+
+  template <class F>
+  struct Range {
+    F* fn;
+    int begin, end, parts;
+  };
+  template <class F>
+  static void RangeTask(void* ctx, int part) noexcept;
+
+  std::vector<std::thread> threads_;
+  std::vector<int> cpu_of_;  // index into the topology cpu list
+  std::vector<int> node_of_;
+  std::vector<int> rank_on_node_;
+  std::vector<int> workers_on_node_;
+  std::vector<int> interleave_slot_;
+  std::mutex run_mu_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::condition_variable done_cv_;
+  std::uint64_t generation_;
+  int pending_;
+  std::vector<std::thread> task_threads_;
+  std::mutex task_mu_;
+  std::condition_variable task_cv_;
+  std::deque<std::function<void()>> tasks_;
+  int idle_tasks_;  // task threads waiting for a task
+  bool draining_;   // a caller is running the queue of an inline pool
+  Task task_;
+  void* ctx_;
+  int parts_;
+};
+
+template <class F>
+void S21ThreadPool::RangeTask(void* ctx, int part) noexcept {
+  Range<F>* r = static_cast<Range<F>*>(ctx);
+  const long n = r->end - r->begin;
+  const int lo = r->begin + static_cast<int>(n * part / r->parts);
+  const int hi = r->begin + static_cast<int>(n * (part + 1) / r->parts);
+  if (lo < hi) (*r->fn)(lo, hi);
+}
+
+template <class F>
+void S21ThreadPool::ParallelFor(const int begin, const int end,
+                                const long cost_per_item, F&& fn) noexcept {
+  ParallelFor(begin, end, cost_per_item, ParallelWork(), std::forward<F>(fn));
+}
+
+template <class F>
+void S21ThreadPool::ParallelFor(const int begin, const int end,
+                                const long cost_per_item, const long min_work,
+                                F&& fn) noexcept {
+  if (begin >= end) return;
+  const int parts = std::min(Workers(), end - begin);
+  if (parts < 2 || InWorker() ||
+      static_cast<long>(end - begin) * cost_per_item < min_work) {
+    fn(begin, end);
+    return;
+  }
+  using Fn = typename std::remove_reference<F>::type;
+  Range<Fn> range{&fn, begin, end, parts};
+  Run(parts, &RangeTask<Fn>, &range);
+}
+
+#endif
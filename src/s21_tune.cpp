@@ -0,0 +1,54 @@
+// Kernel tuning tool: times the dense kernels on this machine and writes
+// the winners to a profile that the library loads at startup from the file
+// named by S21_MATRIX_PROFILE.
+//
+//   s21_tune [-o profile] [-b seconds] [m n k]...
+//
+// Every m n k triple adds a product shape tuned on its own.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+
+#include "s21_matrix_tune.h"
+#include "s21_parallel.h"
+
+int main(int argc, char** argv) {
+  std::string path = "s21_matrix.profile";
+  S21TuneOptions options;
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; ++i) {
+    if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      path = argv[++i];
+    } else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      options.budget = std::atof(argv[++i]);
+    } else {
+      std::fprintf(stderr, "usage: %s [-o profile] [-b seconds] [m n k]...\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+  if ((argc - i) % 3 != 0) {
+    std::fprintf(stderr, "%s: shapes are m n k triples\n", argv[0]);
+    return 2;
+  }
+  for (; i < argc; i += 3) {
+    options.shapes.push_back({std::atoi(argv[i]), std::atoi(argv[i + 1]),
+                              std::atoi(argv[i + 2])});
+  }
+  std::printf("workers=%d budget %.1f s, %zu shapes\n",
+              S21ThreadPool::Instance().Workers(), options.budget,
+              options.shapes.size());
+  try {
+    S21Tuner::Tune(options);
+    S21Tuner::Save(path);
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s: %s\n", argv[0], e.what());
+    return 1;
+  }
+  std::printf("%s", S21Tuner::Format().c_str());
+  std::printf("written to %s\n", path.c_str());
+  return 0;
+}
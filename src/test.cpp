@@ -1,6 +1,46 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef S21_HAVE_MPI
+#include <mpi.h>
+#endif
+
+#include "s21_matrix_accum.h"
+#include "s21_matrix_async.h"
+#include "s21_matrix_cache.h"
+#include "s21_matrix_dist.h"
+#include "s21_matrix_io.h"
+#include "s21_matrix_lowrank.h"
 #include "s21_matrix_oop.h"
+#include "s21_matrix_quant.h"
+#include "s21_matrix_reduce.h"
+#include "s21_matrix_struct.h"
+#include "s21_matrix_tiled.h"
+#include "s21_matrix_tune.h"
+#include "s21_parallel.h"
+
+// counting allocator hook for the allocation-free tests
+static std::atomic<long> allocations{0};
+static std::atomic<long> allocated_bytes{0};
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  allocated_bytes += size;
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
 
 TEST(S21MatrixTest, DefaultConstructor) {
   S21Matrix mat;
@@ -561,6 +601,1197 @@ TEST(S21MatrixTest, OperatorMinus) {
   EXPECT_TRUE(mat3 == mat4);
 }
 
+TEST(S21MatrixTest, Transpose_NotSquare) {
+  S21Matrix mat1 = {{1, 2, 3}, {4, 5, 6}};
+
+  S21Matrix mat2 = {{1, 4}, {2, 5}, {3, 6}};
+
+  EXPECT_TRUE(mat1.Transpose() == mat2);
+}
+
+TEST(S21MatrixTest, MulMatrix_NotSquare) {
+  S21Matrix mat1 = {{1, 2, 3}, {4, 5, 6}};
+
+  S21Matrix mat2 = {{1, 0}, {0, 1}, {1, 1}};
+
+  S21Matrix mat3 = {{4, 5}, {10, 11}};
+
+  mat1.MulMatrix(mat2);
+
+  EXPECT_EQ(mat1.get_Col(), 2);
+  EXPECT_TRUE(mat3 == mat1);
+}
+
+TEST(S21MatrixTest, AtUnchecked) {
+  S21Matrix mat = {{0, 1}, {2, 3}};
+
+  mat.at_unchecked(1, 0) = 7;
+
+  EXPECT_DOUBLE_EQ(mat(1, 0), 7);
+  EXPECT_DOUBLE_EQ(mat.data(1)[1], 3);
+}
+
+TEST(S21MatrixTest, IntoVariants) {
+  S21Matrix mat1 = {{2, 5, 7}, {6, 3, 4}, {5, -2, -3}};
+  S21Matrix mat2 = {{1, -1, 1}, {-38, 41, -34}, {27, -29, 24}};
+  S21Matrix out(1, 1);
+  S21Matrix ws(1, 1);
+
+  mat1.InverseInto(out, ws);
+  EXPECT_TRUE(out == mat2);
+
+  S21Matrix::MulInto(mat1, mat2, ws);
+  EXPECT_TRUE(ws == S21Matrix({{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}));
+
+  mat1.MinorInto(1, 1, out);
+  EXPECT_TRUE(out == S21Matrix({{2, 7}, {5, -3}}));
+
+  EXPECT_THROW(S21Matrix::MulInto(mat1, mat2, mat1), std::invalid_argument);
+  S21Matrix singular = {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}};
+  EXPECT_THROW(singular.InverseInto(out, ws), std::logic_error);
+}
+
+TEST(S21MatrixTest, IntoVariantsAllocateNothingAfterWarmUp) {
+  S21Matrix a = {{4, 1, 2}, {1, 5, 3}, {2, 3, 6}};
+  S21Matrix b = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+  S21Matrix prod(1, 1), tr(1, 1), minor(1, 1), inv(1, 1), ws(1, 1);
+
+  S21Matrix::MulInto(a, b, prod);
+  prod.TransposeInto(tr);
+  a.MinorInto(0, 0, minor);
+  a.InverseInto(inv, ws);
+
+  allocations = 0;
+  for (int k = 0; k < 100; ++k) {
+    S21Matrix::MulInto(a, b, prod);
+    prod.TransposeInto(tr);
+    a.MinorInto(k % 3, (k + 1) % 3, minor);
+    a.InverseInto(inv, ws);
+    inv.at_unchecked(0, 0) += tr.at_unchecked(1, 2) * 0;
+  }
+  long count = allocations;
+
+  EXPECT_EQ(count, 0);
+}
+
+TEST(S21MatrixTest, Placement) {
+  S21Matrix local(300, 300, S21Matrix::Placement::kLocal);
+  S21Matrix interleave(300, 300, S21Matrix::Placement::kInterleave);
+  for (int i = 0; i < 300; ++i) {
+    for (int j = 0; j < 300; ++j) {
+      local(i, j) = (i * 7 + j) % 11;
+    }
+  }
+  EXPECT_TRUE(interleave == S21Matrix(300, 300));
+
+  interleave = local;
+  EXPECT_EQ(interleave.get_Placement(), S21Matrix::Placement::kInterleave);
+  local.set_Placement(S21Matrix::Placement::kPartitioned);
+  EXPECT_EQ(local.get_Placement(), S21Matrix::Placement::kPartitioned);
+  EXPECT_TRUE(interleave == local);
+
+  S21Matrix sum = local + interleave;
+  S21Matrix prod = local * interleave;
+  local.MulNumber(2);
+  EXPECT_TRUE(sum == local);
+  EXPECT_DOUBLE_EQ(prod(1, 2), S21Matrix(interleave.Transpose() *
+                                         interleave.Transpose())(2, 1));
+}
+
+static S21Matrix TestMatrix(int rows, int cols, int seed) {
+  S21Matrix m(rows, cols);
+  unsigned state = 2463534242u + seed;
+  for (int i = 0; i < rows; ++i) {
+    for (int j = 0; j < cols; ++j) {
+      state = state * 1664525u + 1013904223u;
+      m(i, j) = (state >> 8) % 1000 / 100.0 - 5;
+    }
+  }
+  return m;
+}
+
+TEST(S21DistMatrixTest, SummaMatchesSerial) {
+  S21Matrix a = TestMatrix(7, 9, 1);
+  S21Matrix b = TestMatrix(9, 5, 2);
+  S21Matrix result(1, 1);
+  S21SocketCommunicator::Spawn(4, [&](S21Communicator& comm) {
+    S21DistMatrix da(comm, 7, 9, 2);
+    S21DistMatrix db(comm, 9, 5, 2);
+    da.Scatter(a, 0);
+    db.Scatter(b, 0);
+    da.MulMatrix(db);
+    da.Gather(result, 0);
+  });
+
+  EXPECT_TRUE(result == a * b);
+}
+
+TEST(S21DistMatrixTest, DeterminantAndInverse) {
+  S21Matrix a = TestMatrix(7, 7, 3);
+  S21Matrix singular = {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}};
+  S21Matrix inverse(1, 1), ws(1, 1);
+  a.InverseInto(inverse, ws);
+  double det = 0;
+  S21Matrix result(1, 1);
+  bool thrown = false;
+  S21SocketCommunicator::Spawn(6, [&](S21Communicator& comm) {
+    S21DistMatrix da(comm, 7, 7, 2);
+    da.Scatter(a, 0);
+    det = da.Determinant();
+    da.InverseMatrix().Gather(result, 0);
+    S21DistMatrix ds(comm, 3, 3, 1);
+    ds.Scatter(singular, 0);
+    try {
+      ds.InverseMatrix();
+    } catch (const std::logic_error&) {
+      thrown = true;
+    }
+  });
+
+  EXPECT_NEAR(det, a.Determinant(), 1e-6 * fabs(a.Determinant()));
+  EXPECT_TRUE(result == inverse);
+  EXPECT_TRUE(thrown);
+}
+
+TEST(S21DistMatrixTest, BlockedEliminationOnEveryGrid) {
+  // a = l * u with unit lower l, so the determinant is the diagonal of u
+  const int n = 29;
+  S21Matrix l(n, n), u(n, n);
+  double det = 1;
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      if (j < i) l(i, j) = ((i * 7 + j * 3) % 11 - 5) / 10.0;
+      if (j > i) u(i, j) = ((i * 5 + j) % 13 - 6) / 10.0;
+    }
+    l(i, i) = 1;
+    u(i, i) = (i % 3 ? 1 : -1) * (1 + (i % 4) * 0.25);
+    det *= u(i, i);
+  }
+  S21Matrix a = l * u;
+  S21Matrix inverse(1, 1), ws(1, 1);
+  a.InverseInto(inverse, ws);
+  const int kGrids[][2] = {{1, 1}, {2, 2}, {2, 3}, {3, 2}, {3, 1}, {1, 3}};
+  for (const int block : {1, 3, 8, 32}) {
+    for (const auto& grid : kGrids) {
+      double got = 0;
+      S21Matrix result(1, 1);
+      S21SocketCommunicator::Spawn(
+          grid[0] * grid[1], [&](S21Communicator& comm) {
+            S21DistMatrix da(comm, n, n, block, grid[0], grid[1]);
+            da.Scatter(a, 0);
+            got = da.Determinant();
+            da.InverseMatrix().Gather(result, 0);
+          });
+      EXPECT_NEAR(got, det, 1e-9 * fabs(det))
+          << block << " " << grid[0] << "x" << grid[1];
+      EXPECT_TRUE(result == inverse)
+          << block << " " << grid[0] << "x" << grid[1];
+    }
+  }
+}
+
+TEST(S21DistMatrixTest, ChildFailureIsReported) {
+  EXPECT_THROW(S21SocketCommunicator::Spawn(
+                   2,
+                   [](S21Communicator& comm) {
+                     if (comm.Rank() == 1) throw std::runtime_error("boom");
+                     double x = 0;
+                     comm.Recv(1, &x, 1);
+                   }),
+               std::runtime_error);
+}
+
+#ifdef S21_HAVE_MPI
+// make test_mpi runs these on every rank of an mpirun job
+class S21MpiEnvironment : public ::testing::Environment {
+ public:
+  void SetUp() override {
+    int provided = 0;
+    MPI_Init_thread(nullptr, nullptr, MPI_THREAD_SERIALIZED, &provided);
+  }
+  void TearDown() override { MPI_Finalize(); }
+};
+
+static ::testing::Environment* const mpi_environment =
+    ::testing::AddGlobalTestEnvironment(new S21MpiEnvironment);
+
+TEST(S21MpiTest, DistributedMatchesSerial) {
+  S21MpiCommunicator comm;
+  S21Matrix a = TestMatrix(8, 8, 12), b = TestMatrix(8, 5, 13);
+  S21Matrix inverse(1, 1), ws(1, 1);
+  a.InverseInto(inverse, ws);
+  S21DistMatrix da(comm, 8, 8, 3), db(comm, 8, 5, 3);
+  da.Scatter(a, 0);
+  db.Scatter(b, 0);
+  S21Matrix inv(1, 1), product(1, 1);
+  const double det = da.Determinant();
+  da.InverseMatrix().Gather(inv, 0);
+  da.MulMatrix(db);
+  da.Gather(product, 0);
+
+  EXPECT_NEAR(det, a.Determinant(), 1e-9 * fabs(a.Determinant()));
+  if (comm.Rank() == 0) {
+    EXPECT_TRUE(inv == inverse);
+    EXPECT_TRUE(product == a * b);
+  }
+}
+#endif
+
+TEST(S21TaskGraphTest, IndependentNodesAndFusion) {
+  S21Matrix a = TestMatrix(6, 6, 4), b = TestMatrix(6, 6, 5);
+  S21Matrix c = TestMatrix(6, 6, 6), d = TestMatrix(6, 6, 7);
+  S21TaskGraph graph;
+  S21AsyncMatrix ga = graph.Input(a), gb = graph.Input(b);
+  S21AsyncMatrix gc = graph.Input(c), gd = graph.Input(d);
+
+  S21AsyncMatrix res = ga.MulMatrixAsync(gb)
+                           .SumMatrixAsync(gc.MulMatrixAsync(gd))
+                           .MulNumberAsync(0.5)
+                           .SubMatrixAsync(gd);
+  S21AsyncScalar det = ga.DeterminantAsync();
+  S21AsyncMatrix inv = ga.InverseAsync().TransposeAsync();
+  graph.Launch();
+
+  S21Matrix expected = (a * b + c * d) * 0.5 - d;
+  EXPECT_TRUE(res.get() == expected);
+  EXPECT_EQ(graph.FusedNodes(), 2);
+  EXPECT_NEAR(det.get(), a.Determinant(), 1e-6 * fabs(a.Determinant()));
+  EXPECT_TRUE(inv.get() == a.InverseMatrix().Transpose());
+}
+
+TEST(S21TaskGraphTest, ErrorsPropagateToDependents) {
+  S21TaskGraph graph;
+  S21AsyncMatrix singular = graph.Input({{0, 1, 2}, {3, 4, 5}, {6, 7, 8}});
+  S21AsyncMatrix inv = singular.InverseAsync();
+  S21AsyncMatrix res = inv.MulNumberAsync(2);
+  S21AsyncMatrix bad = singular.SumMatrixAsync(graph.Input(S21Matrix(2, 2)));
+
+  EXPECT_THROW(res.get(), std::logic_error);
+  EXPECT_THROW(inv.get(), std::logic_error);
+  EXPECT_THROW(bad.get(), std::out_of_range);
+  EXPECT_TRUE(singular.MulNumberAsync(1).get() == singular.get());
+}
+
+TEST(S21MatrixTest, EqMatrixTolerance) {
+  S21Matrix a = {{1, 1000}, {-3, 0}};
+  S21Matrix b = {{1 + 1e-9, 1000.001}, {-3, 1e-12}};
+
+  EXPECT_FALSE(a.EqMatrix(b, S21Tolerance{1e-9, 0, 0}));
+  EXPECT_TRUE(a.EqMatrix(b, S21Tolerance{1e-8, 1e-5, 0}));
+  EXPECT_FALSE(a.EqMatrix(b, S21Tolerance{0, 1e-5, 0}));
+  EXPECT_TRUE(a.EqMatrix(b, S21Tolerance{1e-11, 1e-5, 0}));
+
+  S21Matrix c = a;
+  c(0, 0) = std::nextafter(std::nextafter(1.0, 2.0), 2.0);
+  EXPECT_TRUE(a.EqMatrix(c, S21Tolerance{0, 0, 2}));
+  EXPECT_FALSE(a.EqMatrix(c, S21Tolerance{0, 0, 1}));
+  EXPECT_FALSE(a.EqMatrix(S21Matrix(2, 3), S21Tolerance()));
+}
+
+TEST(S21MatrixTest, HashFollowsTolerance) {
+  S21Matrix a = {{1.25, -2.5}, {3.75, 1000}};
+  S21Matrix b = {{1.25 + 1e-8, -2.5}, {3.75, 1000 + 1e-8}};
+  S21Matrix c = {{1.5, -2.5}, {3.75, 1000}};
+
+  EXPECT_EQ(a.Hash(), b.Hash());
+  EXPECT_NE(a.Hash(), c.Hash());
+  EXPECT_EQ(a.Hash(S21Tolerance{1e-6, 1e-6, 0}),
+            b.Hash(S21Tolerance{1e-6, 1e-6, 0}));
+  EXPECT_NE(a.Hash(S21Tolerance{0, 0, 0}), b.Hash(S21Tolerance{0, 0, 0}));
+  EXPECT_NE(a.Hash(), S21Matrix(4, 1).Hash());
+}
+
+TEST(S21ResultCacheTest, HitsMissesAndEviction) {
+  S21ResultCache cache(2);
+  S21Matrix a = {{2, 5, 7}, {6, 3, 4}, {5, -2, -3}};
+  S21Matrix b = {{4, 1}, {1, 3}};
+  S21Matrix c = {{1, 2}, {3, 4}};
+  S21Matrix a_noise = a;
+  a_noise(1, 1) += 1e-9;
+
+  EXPECT_TRUE(cache.InverseMatrix(a) == a.InverseMatrix());
+  EXPECT_TRUE(cache.InverseMatrix(a_noise) == a.InverseMatrix());
+  EXPECT_DOUBLE_EQ(cache.Determinant(b), 11);
+  EXPECT_DOUBLE_EQ(cache.Determinant(b), 11);
+  EXPECT_EQ(cache.get_Stats().hits, 2);
+  EXPECT_EQ(cache.get_Stats().misses, 2);
+
+  EXPECT_DOUBLE_EQ(cache.Determinant(c), -2);  // evicts the inverse of a
+  EXPECT_EQ(cache.Size(), 2u);
+  EXPECT_EQ(cache.get_Stats().evictions, 1);
+  cache.InverseMatrix(a);
+  EXPECT_EQ(cache.get_Stats().misses, 4);
+  EXPECT_DOUBLE_EQ(cache.get_Stats().HitRate(), 2.0 / 6);
+  EXPECT_THROW(cache.InverseMatrix(S21Matrix(2, 2)), std::logic_error);
+  // far out of reach of the cofactor expansion
+  S21Matrix big = TestMatrix(40, 40, 10), ws(1, 1);
+  EXPECT_DOUBLE_EQ(cache.Determinant(big), big.DeterminantInto(ws));
+}
+
+TEST(S21TaskGraphTest, HandlesOutliveTheGraph) {
+  S21Matrix a = TestMatrix(5, 5, 8);
+  S21AsyncMatrix later = S21TaskGraph().Input(a);
+  S21AsyncMatrix launched = later.MulNumberAsync(2);
+  launched.get();
+  {
+    S21TaskGraph graph;
+    later = graph.Input(a).TransposeAsync();
+    S21AsyncMatrix other = S21TaskGraph().Input(a);
+    EXPECT_THROW(later.SumMatrixAsync(other), std::invalid_argument);
+  }
+  // recorded but never launched while the graph existed
+  EXPECT_TRUE(later.get() == a.Transpose());
+  EXPECT_TRUE(later.MulMatrixAsync(later).get() ==
+              a.Transpose() * a.Transpose());
+}
+
+TEST(S21TaskGraphTest, DeterminantByElimination) {
+  const int n = 80;
+  S21Matrix l(n, n), u(n, n);
+  double expected = 1;
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      if (j < i) l(i, j) = ((i * 7 + j * 3) % 11 - 5) / 20.0;
+      if (j > i) u(i, j) = ((i * 5 + j) % 13 - 6) / 10.0;
+    }
+    l(i, i) = 1;
+    u(i, i) = (i % 2 ? -1 : 1) * (1 + (i % 4) * 0.25);
+    expected *= u(i, i);
+  }
+  S21Matrix a = l * u;
+  S21TaskGraph graph;
+  const double det = graph.Input(a).DeterminantAsync().get();
+  S21Matrix ws(1, 1);
+
+  EXPECT_NEAR(det, expected, 1e-9 * fabs(expected));
+  EXPECT_NEAR(a.DeterminantInto(ws), expected, 1e-9 * fabs(expected));
+  S21Matrix small = {{2, 5, 7}, {6, 3, 4}, {5, -2, -3}};
+  EXPECT_NEAR(small.DeterminantInto(ws), small.Determinant(), 1e-12);
+  S21Matrix singular = {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}};
+  EXPECT_NEAR(singular.DeterminantInto(ws), 0, 1e-12);
+  EXPECT_THROW(S21Matrix(2, 3).DeterminantInto(ws), std::invalid_argument);
+}
+
+TEST(S21TaskGraphTest, RunsInsideSpawn) {
+  S21Matrix a = TestMatrix(4, 4, 9);
+  S21Matrix expected = a * 2 * a.Transpose();
+  // a forked rank has an inline pool, which runs tasks in the caller
+  S21SocketCommunicator::Spawn(2, [&](S21Communicator&) {
+    S21TaskGraph graph;
+    S21AsyncMatrix x = graph.Input(a);
+    S21AsyncMatrix y = x.MulNumberAsync(2).MulMatrixAsync(x.TransposeAsync());
+    S21AsyncScalar det = x.DeterminantAsync();
+    if (!(y.get() == expected) || fabs(det.get() - a.Determinant()) > 1e-9) {
+      throw std::runtime_error("wrong result");
+    }
+  });
+}
+
+TEST(S21MatrixTest, SetRowsKeepsValues) {
+  S21Matrix mat = {{1, 2}, {3, 4}};
+  mat.set_Row(1);
+  mat.set_Row(3);
+
+  EXPECT_TRUE(mat == S21Matrix({{1, 2}, {0, 0}, {0, 0}}));
+  mat.set_Col(1);
+  mat.set_Col(3);
+  EXPECT_TRUE(mat == S21Matrix({{1, 0, 0}, {0, 0, 0}, {0, 0, 0}}));
+}
+
+TEST(S21MatrixTest, AppendRowAndColAmortized) {
+  S21Matrix mat = {{0, 1}};
+  allocations = 0;
+  for (int i = 1; i < 1000; ++i) {
+    mat.AppendRow({double(2 * i), double(2 * i + 1)});
+  }
+  long count = allocations;
+
+  EXPECT_LE(count, 2 * 10);  // table + block per doubling
+  EXPECT_EQ(mat.get_Row(), 1000);
+  EXPECT_GE(mat.get_RowCapacity(), 1000);
+  EXPECT_DOUBLE_EQ(mat(999, 1), 1999);
+
+  std::vector<double> col(1000);
+  for (int i = 0; i < 1000; ++i) col[i] = -i;
+  for (int j = 0; j < 20; ++j) mat.AppendCol(col.data());
+  EXPECT_EQ(mat.get_Col(), 22);
+  EXPECT_GE(mat.get_ColCapacity(), 22);
+  EXPECT_DOUBLE_EQ(mat(10, 21), -10);
+  EXPECT_DOUBLE_EQ(mat(10, 1), 21);
+  EXPECT_THROW(mat.AppendRow({1, 2}), std::invalid_argument);
+}
+
+TEST(S21MatrixTest, ReserveAndShrink) {
+  S21Matrix mat = {{1, 2}, {3, 4}};
+  mat.reserve(100, 50);
+  EXPECT_GE(mat.get_RowCapacity(), 100);
+  EXPECT_GE(mat.get_ColCapacity(), 50);
+
+  allocations = 0;
+  mat.set_Row(100);
+  mat.set_Col(50);
+  mat.set_Row(2);
+  mat.set_Col(2);
+  long count = allocations;
+  EXPECT_EQ(count, 0);
+  EXPECT_GE(mat.get_RowCapacity(), 100);
+
+  mat.shrink_to_fit();
+  EXPECT_EQ(mat.get_RowCapacity(), 2);
+  EXPECT_EQ(mat.get_ColCapacity(), 2);
+  EXPECT_TRUE(mat == S21Matrix({{1, 2}, {3, 4}}));
+}
+
+TEST(S21MatrixIOTest, CsvRoundTripIsExact) {
+  S21Matrix m = TestMatrix(700, 30, 7);
+  m.MulNumber(1.0 / 3);
+  m(0, 0) = -0.0;
+  m(0, 1) = 1e-300;
+  m(0, 2) = 0.1 + 0.2;
+  m(1, 0) = -std::numeric_limits<double>::max();
+  m(1, 1) = std::numeric_limits<double>::denorm_min();
+  const std::string text = S21MatrixIO::FormatCsv(m);
+  S21Matrix back = S21MatrixIO::ParseCsv(text);
+
+  ASSERT_EQ(back.get_Row(), 700);
+  ASSERT_EQ(back.get_Col(), 30);
+  for (int i = 0; i < 700; ++i) {
+    for (int j = 0; j < 30; ++j) {
+      ASSERT_EQ(std::memcmp(&back(i, j), &m(i, j), sizeof(double)), 0);
+    }
+  }
+  const std::string path = "s21_matrix_io_test.csv";
+  S21MatrixIO::ToCsv(m, path, ';');
+  EXPECT_TRUE(S21MatrixIO::FromCsv(path, ';').EqMatrix(m, S21Tolerance{0}));
+  std::remove(path.c_str());
+}
+
+TEST(S21MatrixIOTest, CsvFormatAndErrors) {
+  S21Matrix m =
+      S21MatrixIO::ParseCsv("\n1, +2.5 ,3\r\n\n-4,5e1,6\n", ',');
+  EXPECT_TRUE(m == S21Matrix({{1, 2.5, 3}, {-4, 50, 6}}));
+  EXPECT_TRUE(S21MatrixIO::ParseCsv("1 \t 2\n3 4", ' ') ==
+              S21Matrix({{1, 2}, {3, 4}}));
+  EXPECT_EQ(S21MatrixIO::FormatCsv(S21Matrix({{0.5, -2}})), "0.5,-2\n");
+
+  EXPECT_THROW(S21MatrixIO::ParseCsv(""), std::invalid_argument);
+  EXPECT_THROW(S21MatrixIO::ParseCsv("1,2\n3\n"), std::invalid_argument);
+  EXPECT_THROW(S21MatrixIO::ParseCsv("1,2\n3,4,5\n"), std::invalid_argument);
+  try {
+    S21MatrixIO::ParseCsv("1,2\n\n3,x\n");
+    FAIL();
+  } catch (const std::invalid_argument& err) {
+    EXPECT_STREQ(err.what(), "ParseCsv: line 3: not a number");
+  }
+  EXPECT_THROW(S21MatrixIO::FromCsv("no/such/file.csv"), std::runtime_error);
+}
+
+TEST(S21MatrixIOTest, MatrixMarket) {
+  S21Matrix sym = S21MatrixIO::ParseMatrixMarket(
+      "%%MatrixMarket matrix coordinate real symmetric\n"
+      "% comment\n"
+      "3 3 3\n"
+      "1 1 2.5\n"
+      "3 1 -1\n"
+      "2 2 4\n");
+  EXPECT_TRUE(sym == S21Matrix({{2.5, 0, -1}, {0, 4, 0}, {-1, 0, 0}}));
+
+  S21Matrix skew = S21MatrixIO::ParseMatrixMarket(
+      "%%MatrixMarket matrix array real skew-symmetric\n3 3\n1\n2\n3\n");
+  EXPECT_TRUE(skew == S21Matrix({{0, -1, -2}, {1, 0, -3}, {2, 3, 0}}));
+
+  S21Matrix m = {{1, 2, 3}, {4, 5, 6}};
+  const std::string text = S21MatrixIO::FormatMatrixMarket(m);
+  EXPECT_EQ(text,
+            "%%MatrixMarket matrix array real general\n2 3\n"
+            "1\n4\n2\n5\n3\n6\n");
+  EXPECT_TRUE(S21MatrixIO::ParseMatrixMarket(text) == m);
+
+  const std::string path = "s21_matrix_io_test.mtx";
+  S21Matrix big = TestMatrix(200, 100, 3);
+  S21MatrixIO::ToMatrixMarket(big, path);
+  EXPECT_TRUE(
+      S21MatrixIO::FromMatrixMarket(path).EqMatrix(big, S21Tolerance{0}));
+  std::remove(path.c_str());
+
+  EXPECT_THROW(S21MatrixIO::ParseMatrixMarket("1 2\n"), std::invalid_argument);
+  EXPECT_THROW(S21MatrixIO::ParseMatrixMarket(
+                   "%%MatrixMarket matrix coordinate real general\n"
+                   "2 2 1\n3 1 1\n"),
+               std::invalid_argument);
+  EXPECT_THROW(S21MatrixIO::ParseMatrixMarket(
+                   "%%MatrixMarket matrix array real general\n2 2\n1\n"),
+               std::invalid_argument);
+  const std::pair<const char*, const char*> kEntryErrors[] = {
+      {"%%MatrixMarket matrix coordinate real symmetric\n2 2 1\n1 2 1\n",
+       "line 3: entry above the diagonal"},
+      {"%%MatrixMarket matrix coordinate real skew-symmetric\n2 2 1\n"
+       "2 2 1\n",
+       "line 3: diagonal entry"},
+      {"%%MatrixMarket matrix coordinate real general\n2 2 2\n1 2 1\n"
+       "1 2 3\n",
+       "line 4: duplicate entry"},
+      {"%%MatrixMarket matrix coordinate real general\n2 2 2\n1 1 1\n"
+       "1e300 1 3\n",
+       "line 4: bad index"},
+      {"%%MatrixMarket matrix coordinate real general\n2 2 1\nnan 1 1\n",
+       "line 3: bad index"},
+      {"%%MatrixMarket matrix coordinate real general\n2 2 1\n1 inf 1\n",
+       "line 3: bad index"},
+      {"%%MatrixMarket matrix coordinate real general\n2 2 1\n1 1.5 1\n",
+       "line 3: bad index"},
+  };
+  for (const auto& e : kEntryErrors) {
+    try {
+      S21MatrixIO::ParseMatrixMarket(e.first);
+      ADD_FAILURE() << e.first;
+    } catch (const std::invalid_argument& error) {
+      EXPECT_NE(std::string(error.what()).find(e.second), std::string::npos)
+          << error.what();
+    }
+  }
+}
+
+TEST(S21MatrixIOTest, MatrixMarketLargeTriangles) {
+  const int n = 150;
+  std::string sym = "%%MatrixMarket matrix array real symmetric\n150 150\n";
+  std::string skew =
+      "%%MatrixMarket matrix array real skew-symmetric\n150 150\n";
+  for (int j = 0; j < n; ++j) {
+    for (int i = j; i < n; ++i) {
+      const std::string v = std::to_string(i * 1000 + j) + "\n";
+      sym += v;
+      if (i > j) skew += v;
+    }
+  }
+  S21Matrix s = S21MatrixIO::ParseMatrixMarket(sym);
+  S21Matrix k = S21MatrixIO::ParseMatrixMarket(skew);
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j <= i; ++j) {
+      EXPECT_EQ(s(i, j), i * 1000 + j);
+      EXPECT_EQ(s(j, i), i * 1000 + j);
+      EXPECT_EQ(k(i, j), i == j ? 0 : i * 1000 + j);
+      EXPECT_EQ(k(j, i), i == j ? 0 : -(i * 1000 + j));
+    }
+  }
+}
+
+TEST(S21StructTest, DetectStructure) {
+  S21Matrix m = {{1, 2, 0, 0}, {2, 3, 4, 0}, {0, 4, 5, 6}, {0, 0, 6, 7}};
+  S21Structure s = S21Structure::Detect(m);
+  EXPECT_TRUE(s.square);
+  EXPECT_TRUE(s.symmetric);
+  EXPECT_EQ(s.kl, 1);
+  EXPECT_EQ(s.ku, 1);
+
+  m(0, 3) = 1e-9;
+  s = S21Structure::Detect(m);
+  EXPECT_FALSE(s.symmetric);
+  EXPECT_EQ(s.ku, 3);
+  s = S21Structure::Detect(m, 1e-6);
+  EXPECT_TRUE(s.symmetric);
+  EXPECT_EQ(s.ku, 1);
+
+  S21Matrix upper = {{1, 2, 3}, {0, 4, 5}};
+  s = S21Structure::Detect(upper);
+  EXPECT_FALSE(s.square);
+  EXPECT_TRUE(s.Upper());
+  EXPECT_FALSE(s.Lower());
+}
+
+TEST(S21StructTest, PackedMatrix) {
+  S21Matrix dense = TestMatrix(60, 60, 5);
+  S21Matrix sym = dense;
+  S21Matrix lower = dense;
+  for (int i = 0; i < 60; ++i) {
+    lower(i, i) += 20;
+    for (int j = i + 1; j < 60; ++j) {
+      sym(i, j) = sym(j, i);
+      lower(i, j) = 0;
+    }
+  }
+  S21Matrix b = TestMatrix(60, 3, 9);
+  S21Tolerance tol{1e-9, 1e-9};
+
+  S21PackedMatrix ps =
+      S21PackedMatrix::FromDense(sym, S21PackedMatrix::Kind::kSymmetric);
+  EXPECT_EQ(ps.Elements(), 60u * 61 / 2);
+  EXPECT_TRUE(ps.ToDense() == sym);
+  EXPECT_TRUE(ps.MulMatrix(b).EqMatrix(sym * b, tol));
+  ps.at(3, 50) = 1;
+  EXPECT_DOUBLE_EQ(ps(50, 3), 1);
+
+  S21PackedMatrix pl =
+      S21PackedMatrix::FromDense(lower, S21PackedMatrix::Kind::kLower);
+  EXPECT_TRUE(pl.MulMatrix(b).EqMatrix(lower * b, tol));
+  EXPECT_TRUE((lower * pl.Solve(b)).EqMatrix(b, tol));
+  EXPECT_DOUBLE_EQ(pl(0, 1), 0);
+  EXPECT_THROW(pl.at(0, 1) = 1, std::out_of_range);
+
+  S21Matrix upper = lower.Transpose();
+  S21PackedMatrix pu =
+      S21PackedMatrix::FromDense(upper, S21PackedMatrix::Kind::kUpper);
+  EXPECT_TRUE(pu.ToDense() == upper);
+  EXPECT_TRUE((upper * pu.Solve(b)).EqMatrix(b, tol));
+  EXPECT_NEAR(pu.Determinant() / pl.Determinant(), 1, 1e-12);
+
+  S21Matrix small = {{2, 1, 0}, {1, 3, 1}, {0, 1, 4}};
+  S21PackedMatrix p3 =
+      S21PackedMatrix::FromDense(small, S21PackedMatrix::Kind::kSymmetric);
+  EXPECT_NEAR(p3.Determinant(), small.Determinant(), 1e-12);
+  EXPECT_THROW(p3.Solve(b), std::logic_error);
+}
+
+TEST(S21StructTest, PackedSymmetricDeterminant) {
+  // zero diagonals force 2 x 2 pivots and interchanges
+  S21Matrix pivots = {{0, 1, 2}, {1, 0, 3}, {2, 3, 0}};
+  S21PackedMatrix pp =
+      S21PackedMatrix::FromDense(pivots, S21PackedMatrix::Kind::kSymmetric);
+  EXPECT_NEAR(pp.Determinant(), 12, 1e-12);
+  S21Matrix singular = {{1, 2, 3}, {2, 4, 6}, {3, 6, 9}};
+  EXPECT_EQ(S21PackedMatrix::FromDense(singular,
+                                       S21PackedMatrix::Kind::kSymmetric)
+                .Determinant(),
+            0);
+
+  const int n = 80;
+  S21Matrix sym = TestMatrix(n, n, 13);
+  for (int i = 0; i < n; ++i) {
+    sym(i, i) *= 0.01;
+    for (int j = i + 1; j < n; ++j) sym(i, j) = sym(j, i);
+  }
+  S21PackedMatrix ps =
+      S21PackedMatrix::FromDense(sym, S21PackedMatrix::Kind::kSymmetric);
+  const double expected =
+      S21BandMatrix::FromDense(sym, n - 1, n - 1).Determinant();
+  allocated_bytes = 0;
+  const double det = ps.Determinant();
+  const long bytes = allocated_bytes;
+  EXPECT_NEAR(det / expected, 1, 1e-9);
+  // a packed copy and two vectors, less than one dense matrix
+  EXPECT_LE(bytes, long(n) * n * long(sizeof(double)));
+}
+
+TEST(S21StructTest, BandMatrix) {
+  const int n = 200;
+  S21Matrix dense(n, n);
+  S21Matrix full = TestMatrix(n, n, 11);
+  for (int i = 0; i < n; ++i) {
+    for (int j = std::max(0, i - 2); j <= std::min(n - 1, i + 1); ++j) {
+      dense(i, j) = full(i, j);
+    }
+  }
+  S21BandMatrix band = S21BandMatrix::FromDense(dense, 2, 1);
+  EXPECT_EQ(band.Elements(), std::size_t(n) * 4);
+  EXPECT_TRUE(band.ToDense() == dense);
+  EXPECT_DOUBLE_EQ(band(5, 5), dense(5, 5));
+  EXPECT_DOUBLE_EQ(band(5, 9), 0);
+  EXPECT_THROW(band.at(5, 9) = 1, std::out_of_range);
+
+  S21Matrix b = TestMatrix(n, 2, 13);
+  S21Tolerance tol{1e-8, 1e-9};
+  EXPECT_TRUE(band.MulMatrix(b).EqMatrix(dense * b, tol));
+  EXPECT_TRUE((dense * band.Solve(b)).EqMatrix(b, tol));
+
+  S21Matrix small = {{0, 2, 0}, {1, 1, 3}, {0, 4, 5}};
+  S21BandMatrix tri = S21BandMatrix::FromDense(small, 1, 1);
+  EXPECT_NEAR(tri.Determinant(), small.Determinant(), 1e-12);
+  S21Matrix singular = {{1, 2}, {2, 4}};
+  EXPECT_EQ(S21BandMatrix::FromDense(singular, 1, 1).Determinant(), 0);
+  EXPECT_THROW(S21BandMatrix::FromDense(singular, 1, 1).Solve(b),
+               std::invalid_argument);
+  S21Matrix rhs(2, 1);
+  EXPECT_THROW(S21BandMatrix::FromDense(singular, 1, 1).Solve(rhs),
+               std::logic_error);
+}
+
+TEST(S21TiledTest, LayoutsAreTransparent) {
+  S21Matrix m = TestMatrix(37, 50, 17);
+  for (S21TiledMatrix::Order order :
+       {S21TiledMatrix::Order::kBlockMajor, S21TiledMatrix::Order::kMorton}) {
+    S21TiledMatrix t(m, order, 8);
+    EXPECT_EQ(t.TileRows(), 5);
+    EXPECT_EQ(t.TileCols(), 7);
+    EXPECT_DOUBLE_EQ(t(36, 49), m(36, 49));
+    EXPECT_DOUBLE_EQ(t(9, 17), m(9, 17));
+    EXPECT_TRUE(t.ToDense() == m);
+    t(20, 30) = 5;
+    EXPECT_DOUBLE_EQ(t.ToDense()(20, 30), 5);
+    EXPECT_THROW(t(37, 0), std::out_of_range);
+  }
+  EXPECT_THROW(S21TiledMatrix(4, 4, S21TiledMatrix::Order::kMorton, 6),
+               std::invalid_argument);
+}
+
+TEST(S21TiledTest, TileIteratorsCoverTheMatrix) {
+  S21TiledMatrix t(20, 12, S21TiledMatrix::Order::kMorton, 8);
+  int blocks = 0;
+  long cells = 0;
+  for (S21TiledMatrix::Tile tile : t) {
+    for (int r = 0; r < tile.rows; ++r) {
+      for (int c = 0; c < tile.cols; ++c) {
+        tile.data[r * tile.stride + c] = (tile.row + r) * 100 + tile.col + c;
+        ++cells;
+      }
+    }
+    ++blocks;
+  }
+  EXPECT_EQ(blocks, 3 * 2);
+  EXPECT_EQ(cells, 20 * 12);
+  // the Z curve starts with the top left 2 x 2 blocks
+  const S21TiledMatrix& ct = t;
+  S21TiledMatrix::ConstTileIterator it = ct.begin();
+  EXPECT_EQ((*it).row, 0);
+  EXPECT_EQ((*++it).col, 8);
+  EXPECT_EQ((*++it).row, 8);
+  EXPECT_DOUBLE_EQ(ct(19, 11), 1911);
+  EXPECT_EQ(ct.tile(2, 1).rows, 4);
+  EXPECT_EQ(ct.tile(2, 1).cols, 4);
+}
+
+TEST(S21TiledTest, TransposeAndMulMatchDense) {
+  S21Matrix a = TestMatrix(70, 45, 19);
+  S21Matrix b = TestMatrix(45, 33, 23);
+  S21TiledMatrix ta(a, S21TiledMatrix::Order::kMorton, 16);
+  S21TiledMatrix tb(b, S21TiledMatrix::Order::kBlockMajor, 16);
+
+  EXPECT_TRUE(ta.Transpose().ToDense() == a.Transpose());
+  EXPECT_TRUE(ta.MulMatrix(tb).ToDense().EqMatrix(a * b, S21Tolerance{1e-9}));
+  EXPECT_THROW(ta.MulMatrix(ta), std::invalid_argument);
+  EXPECT_THROW(ta.MulMatrix(S21TiledMatrix(b, S21TiledMatrix::Order::kMorton)),
+               std::invalid_argument);
+}
+
+TEST(S21MatrixTest, PowerBySquaring) {
+  S21Matrix a = TestMatrix(6, 6, 29);
+  a.MulNumber(0.3);
+  S21Matrix expected = a;
+  for (int i = 1; i < 13; ++i) expected = expected * a;
+  S21Tolerance tol{1e-9, 1e-9};
+  EXPECT_TRUE(a.Power(13).EqMatrix(expected, tol));
+  EXPECT_TRUE(a.Power(1) == a);
+
+  S21Matrix identity(6, 6);
+  for (int i = 0; i < 6; ++i) identity(i, i) = 1;
+  EXPECT_TRUE(a.Power(0) == identity);
+  EXPECT_TRUE((a.Power(-3) * a.Power(3)).EqMatrix(identity, tol));
+
+  S21Matrix out(6, 6), base(6, 6), scratch(6, 6);
+  a.PowerInto(100, out, base, scratch);
+  allocations = 0;
+  a.PowerInto(1000, out, base, scratch);
+  long count = allocations;
+  EXPECT_EQ(count, 0);
+  EXPECT_THROW(a.PowerInto(2, out, out, scratch), std::invalid_argument);
+  EXPECT_THROW(S21Matrix(2, 3).Power(2), std::invalid_argument);
+  EXPECT_THROW(S21Matrix(2, 2).Power(-1), std::logic_error);
+}
+
+TEST(S21MatrixTest, ExpPade) {
+  S21Matrix diag = {{1, 0}, {0, -2}};
+  S21Matrix e = diag.Exp();
+  EXPECT_NEAR(e(0, 0), std::exp(1.0), 1e-14);
+  EXPECT_NEAR(e(1, 1), std::exp(-2.0), 1e-15);
+  EXPECT_EQ(e(0, 1), 0);
+
+  S21Matrix nilpotent = {{0, 1e-3}, {0, 0}};
+  EXPECT_TRUE(nilpotent.Exp().EqMatrix(S21Matrix({{1, 1e-3}, {0, 1}}),
+                                       S21Tolerance{1e-15}));
+
+  // large norm: scaled by 2^-s and squared back
+  const double t = 10;
+  S21Matrix rotation = {{0, -t}, {t, 0}};
+  S21Matrix r = rotation.Exp();
+  S21Tolerance tol{1e-12};
+  EXPECT_TRUE(r.EqMatrix(S21Matrix({{std::cos(t), -std::sin(t)},
+                                    {std::sin(t), std::cos(t)}}),
+                         tol));
+
+  S21Matrix a = TestMatrix(20, 20, 31);
+  a.MulNumber(0.1);
+  S21Matrix minus = a * -1.0;
+  S21Matrix identity(20, 20);
+  for (int i = 0; i < 20; ++i) identity(i, i) = 1;
+  EXPECT_TRUE((a.Exp() * minus.Exp()).EqMatrix(identity, S21Tolerance{1e-10}));
+
+  std::vector<S21Matrix> batch = {diag, rotation, a};
+  std::vector<S21Matrix> res = S21Matrix::ExpBatch(batch);
+  ASSERT_EQ(res.size(), 3u);
+  EXPECT_TRUE(res[1] == r);
+  EXPECT_TRUE(res[2] == a.Exp());
+  batch.push_back(S21Matrix(2, 3));
+  EXPECT_THROW(S21Matrix::ExpBatch(batch), std::invalid_argument);
+}
+
+static double RelativeError(const S21Matrix& a, const S21Matrix& b) {
+  double diff = 0, norm = 0;
+  for (int i = 0; i < a.get_Row(); ++i) {
+    for (int j = 0; j < a.get_Col(); ++j) {
+      diff += (a(i, j) - b(i, j)) * (a(i, j) - b(i, j));
+      norm += a(i, j) * a(i, j);
+    }
+  }
+  return std::sqrt(diff / norm);
+}
+
+TEST(S21LowRankTest, ExactSvd) {
+  S21Matrix a = TestMatrix(8, 12, 37);
+  S21LowRank::Svd svd = S21LowRank::ExactSvd(a);
+  ASSERT_EQ(svd.s.size(), 8u);
+  EXPECT_LT(RelativeError(a, S21LowRank::Reconstruct(svd)), 1e-13);
+  for (std::size_t i = 1; i < svd.s.size(); ++i) {
+    EXPECT_GE(svd.s[i - 1], svd.s[i]);
+  }
+  S21Matrix identity(8, 8);
+  for (int i = 0; i < 8; ++i) identity(i, i) = 1;
+  EXPECT_TRUE(
+      (svd.u.Transpose() * svd.u).EqMatrix(identity, S21Tolerance{1e-12}));
+
+  S21LowRank::Svd tall = S21LowRank::ExactSvd(a.Transpose());
+  EXPECT_EQ(tall.u.get_Row(), 12);
+  for (std::size_t i = 0; i < svd.s.size(); ++i) {
+    EXPECT_NEAR(tall.s[i], svd.s[i], 1e-12);
+  }
+}
+
+TEST(S21LowRankTest, RandomizedSvdRecoversKnownRank) {
+  S21Matrix a = TestMatrix(60, 5, 41) * TestMatrix(5, 80, 43);
+  S21LowRankOptions options;
+  options.rank = 5;
+  options.oversampling = 5;
+  options.power_iterations = 1;
+  for (S21Sketch::Kind kind :
+       {S21Sketch::Kind::kGaussian, S21Sketch::Kind::kSrht}) {
+    options.sketch = kind;
+    S21LowRank::Svd svd = S21LowRank::RandomizedSvd(a, options);
+    EXPECT_EQ(svd.u.get_Col(), 5);
+    EXPECT_EQ(svd.vt.get_Row(), 5);
+    EXPECT_LT(RelativeError(a, S21LowRank::Reconstruct(svd)), 1e-10);
+  }
+  S21Matrix q = S21LowRank::RangeFinder(a, options);
+  EXPECT_EQ(q.get_Col(), 10);
+  EXPECT_TRUE(S21Sketch::Range(a, 7, S21Sketch::Kind::kSrht, 3) ==
+              S21Sketch::Range(a, 7, S21Sketch::Kind::kSrht, 3));
+  EXPECT_EQ(S21Sketch::Rows(a, 7, S21Sketch::Kind::kGaussian, 3).get_Row(), 7);
+  options.rank = 0;
+  EXPECT_THROW(S21LowRank::RandomizedSvd(a, options), std::invalid_argument);
+}
+
+TEST(S21LowRankTest, InterpolativeDecomposition) {
+  S21Matrix a = TestMatrix(50, 4, 47) * TestMatrix(4, 70, 53);
+  S21LowRankOptions options;
+  options.rank = 6;
+  S21LowRank::Id id = S21LowRank::InterpolativeDecomposition(a, options);
+  // rank 4: the dependent columns stop the pivoting early
+  ASSERT_EQ(id.cols.size(), 4u);
+  EXPECT_EQ(id.p.get_Row(), 4);
+  EXPECT_DOUBLE_EQ(id.p(1, id.cols[1]), 1);
+  EXPECT_DOUBLE_EQ(id.p(0, id.cols[1]), 0);
+  EXPECT_LT(RelativeError(a, S21LowRank::Reconstruct(a, id)), 1e-10);
+}
+
+TEST(S21TunerTest, BlockedKernelsMatchPlain) {
+  S21Matrix a = TestMatrix(37, 70, 29);
+  S21Matrix b = TestMatrix(70, 45, 31);
+  S21KernelParams plain;
+  plain.mul_blocked_min = 1 << 30;
+  S21Matrix expected, c, t, tt;
+  S21Matrix::MulInto(a, b, expected, plain);
+  a.TransposeInto(tt);
+  for (int unroll : {1, 2, 4}) {
+    S21KernelParams p;
+    p.mul_blocked_min = 0;
+    p.mul_block_rows = 5;
+    p.mul_block_depth = 7;
+    p.mul_block_cols = 11;
+    p.mul_unroll = unroll;
+    p.transpose_block = unroll + 2;
+    S21Matrix::MulInto(a, b, c, p);
+    // same summation order, so bit-identical
+    EXPECT_TRUE(c.EqMatrix(expected, S21Tolerance{0}));
+    a.TransposeInto(t, p);
+    EXPECT_TRUE(t == tt);
+  }
+  S21KernelParams bad;
+  bad.mul_unroll = 3;
+  EXPECT_THROW(S21Matrix::MulInto(a, b, c, bad), std::invalid_argument);
+  bad = S21KernelParams();
+  bad.transpose_block = 0;
+  EXPECT_THROW(a.TransposeInto(t, bad), std::invalid_argument);
+}
+
+TEST(S21TunerTest, ProfileRoundTrip) {
+  S21KernelParams p;
+  p.mul_block_rows = 16;
+  p.transpose_block = 8;
+  p.parallel_work = 1 << 14;
+  S21Tuner::SetDefaults(p);
+  S21KernelParams shape = p;
+  shape.mul_block_cols = 128;
+  shape.mul_unroll = 2;
+  S21Tuner::SetMul(500, 300, 200, shape);
+  EXPECT_EQ(S21Tuner::ForMul(512, 260, 129).mul_block_cols, 128);
+  EXPECT_EQ(S21Tuner::ForMul(512, 260, 128).mul_block_cols, 512);
+  EXPECT_EQ(S21ThreadPool::ParallelWork(), 1 << 14);
+
+  const std::string path = "s21_matrix_tune_test.profile";
+  S21Tuner::Save(path);
+  const std::string text = S21Tuner::Format();
+  S21Tuner::Reset();
+  EXPECT_EQ(S21Tuner::Defaults().mul_block_rows, 64);
+  EXPECT_EQ(S21ThreadPool::ParallelWork(), S21ThreadPool::kParallelWork);
+  S21Tuner::Load(path);
+  std::remove(path.c_str());
+  EXPECT_EQ(S21Tuner::Format(), text);
+  EXPECT_EQ(S21Tuner::Defaults().transpose_block, 8);
+  EXPECT_EQ(S21Tuner::ForMul(300, 300, 200).mul_unroll, 2);
+  EXPECT_EQ(S21Tuner::ForMul(300, 300, 200).mul_block_rows, 16);
+
+  S21Tuner::Parse("# comment only\nmul_unroll 2  # trailing\n");
+  EXPECT_EQ(S21Tuner::Defaults().mul_unroll, 2);
+  EXPECT_EQ(S21Tuner::ForMul(300, 300, 200).mul_unroll, 2);
+  EXPECT_THROW(S21Tuner::Parse("mul_unroll 3\n"), std::invalid_argument);
+  EXPECT_THROW(S21Tuner::Parse("\nblock 3\n"), std::invalid_argument);
+  EXPECT_THROW(S21Tuner::Parse("mul 4 4 4 transpose_block 8\n"),
+               std::invalid_argument);
+  EXPECT_THROW(S21Tuner::Parse("mul_block_rows\n"), std::invalid_argument);
+  EXPECT_THROW(S21Tuner::Load("/nonexistent/profile"), std::runtime_error);
+  EXPECT_EQ(S21Tuner::Defaults().mul_unroll, 2);  // failed loads change nothing
+  S21Tuner::Reset();
+}
+
+TEST(S21TunerTest, TuneWithinBudget) {
+  S21TuneOptions options;
+  options.budget = 0.2;
+  options.shapes.push_back({40, 40, 40});
+  S21Tuner::Tune(options);
+  EXPECT_NO_THROW(S21Tuner::Validate(S21Tuner::Defaults()));
+  S21Matrix a = TestMatrix(90, 90, 37);
+  S21KernelParams plain;
+  plain.mul_blocked_min = 1 << 30;
+  S21Matrix expected;
+  S21Matrix::MulInto(a, a, expected, plain);
+  EXPECT_TRUE((a * a).EqMatrix(expected, S21Tolerance{0}));
+
+  // first use of an unseen shape tunes it once and spends the budget
+  S21Tuner::Reset();
+  S21Tuner::SetFirstUseBudget(0.05);
+  S21Matrix b = TestMatrix(100, 100, 41);
+  S21Matrix c = b * b;
+  EXPECT_LT(S21Tuner::FirstUseBudget(), 0.05);
+  EXPECT_NE(S21Tuner::Format().find("mul 128 128 128"), std::string::npos);
+  const double left = S21Tuner::FirstUseBudget();
+  c = b * b;
+  EXPECT_EQ(S21Tuner::FirstUseBudget(), left);
+  S21Tuner::Reset();
+  EXPECT_EQ(S21Tuner::FirstUseBudget(), 0);
+}
+
+TEST(S21QuantTest, FormatsRoundTrip) {
+  S21Matrix m = {{1, -2.5, 65504, 0.1, 1e-6, 6e-8, -0.0},
+                 {3.140625, 1e30, -1e-40, 0, 255, -3e38, 1}};
+  S21QuantizedMatrix bf(m, S21QuantizedMatrix::Format::kBfloat16);
+  EXPECT_DOUBLE_EQ(bf(0, 0), 1);
+  EXPECT_DOUBLE_EQ(bf(0, 1), -2.5);
+  EXPECT_DOUBLE_EQ(bf(1, 4), 255);  // 8 significant bits
+  EXPECT_NEAR(bf(1, 1), 1e30, 1e30 / 256);
+  EXPECT_TRUE(std::signbit(bf(0, 6)));
+  EXPECT_LE(bf.get_Error(), 3e38 / 256);
+
+  m(1, 1) = 1e4;
+  m(1, 5) = -30001;
+  m(1, 2) = -1e-7;
+  S21QuantizedMatrix half(m, S21QuantizedMatrix::Format::kHalf);
+  EXPECT_DOUBLE_EQ(half(0, 2), 65504);
+  EXPECT_DOUBLE_EQ(half(1, 0), 3.140625);
+  EXPECT_DOUBLE_EQ(half(0, 5), std::nearbyint(6e-8 * 0x1p24) * 0x1p-24);
+  EXPECT_NEAR(half(0, 3), 0.1, 0.1 / 2048);
+  EXPECT_DOUBLE_EQ(half(1, 5), -30000);  // spacing 16 above 2^14
+  S21Matrix dense = half.ToDense();
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 7; ++j) {
+      EXPECT_LE(std::fabs(dense(i, j) - m(i, j)), half.get_Error());
+    }
+  }
+  m(0, 2) = 65520;
+  EXPECT_THROW(S21QuantizedMatrix(m, S21QuantizedMatrix::Format::kHalf),
+               std::invalid_argument);
+  m(0, 2) = std::nan("");
+  EXPECT_THROW(S21QuantizedMatrix(m, S21QuantizedMatrix::Format::kInt8),
+               std::invalid_argument);
+
+  S21Matrix r = TestMatrix(30, 50, 43);
+  S21QuantizedMatrix q(r, S21QuantizedMatrix::Format::kInt8);
+  EXPECT_EQ(q.Bytes(), 30u * 50 + 2 * 30 * sizeof(double));
+  double bound = 0;  // half a step of the largest row scale
+  for (int i = 0; i < 30; ++i) {
+    for (int j = 0; j < 50; ++j) {
+      bound = std::max(bound, std::fabs(r(i, j)) / 254 * (1 + 1e-12));
+    }
+  }
+  EXPECT_LE(q.get_Error(), bound);
+  EXPECT_GT(q.get_Error(), 0);
+  EXPECT_THROW(q(30, 0), std::out_of_range);
+}
+
+TEST(S21QuantTest, DequantizingProductMatchesDense) {
+  S21Matrix a = TestMatrix(45, 300, 47);
+  S21Matrix w = TestMatrix(300, 270, 53);
+  S21Matrix x = TestMatrix(270, 20, 59);
+  S21Matrix exact = a * w;
+  for (S21QuantizedMatrix::Format format :
+       {S21QuantizedMatrix::Format::kHalf,
+        S21QuantizedMatrix::Format::kBfloat16,
+        S21QuantizedMatrix::Format::kInt8}) {
+    S21QuantizedMatrix q(w, format);
+    S21Matrix dense = q.ToDense();
+    S21Matrix out;
+    S21QuantizedMatrix::MulInto(a, q, out);
+    EXPECT_TRUE(out.EqMatrix(a * dense, S21Tolerance{1e-12}));
+    double worst = 0;
+    for (int i = 0; i < 45; ++i) {
+      for (int j = 0; j < 270; ++j) {
+        worst = std::max(worst, std::fabs(out(i, j) - exact(i, j)));
+      }
+    }
+    EXPECT_LE(worst, S21QuantizedMatrix::ErrorBound(a, q) + 1e-9);
+    EXPECT_GT(worst, 0);
+
+    S21Matrix left = q.MulMatrix(x);
+    EXPECT_TRUE(left.EqMatrix(dense * x, S21Tolerance{1e-12}));
+    EXPECT_TRUE(left.EqMatrix(w * x, S21Tolerance{
+                                         S21QuantizedMatrix::ErrorBound(q, x) +
+                                         1e-9}));
+    EXPECT_THROW(q.MulMatrix(a), std::invalid_argument);
+    EXPECT_THROW(S21QuantizedMatrix::MulInto(x, q, out),
+                 std::invalid_argument);
+  }
+}
+
+TEST(S21ReduceTest, ReductionsAlongBothAxes) {
+  S21Matrix m = {{1, -7, 3, 3}, {4, 5, -6, 0}, {2, 2, 9, -1}};
+  S21Matrix rows = S21Reduce::Sum(m, S21Axis::kRows);
+  EXPECT_EQ(rows.get_Row(), 3);
+  EXPECT_EQ(rows.get_Col(), 1);
+  EXPECT_TRUE(rows == S21Matrix({{0}, {3}, {12}}));
+  EXPECT_TRUE(S21Reduce::Sum(m, S21Axis::kCols) ==
+              S21Matrix({{7, 0, 6, 2}}));
+  EXPECT_TRUE(S21Reduce::Mean(m, S21Axis::kRows) ==
+              S21Matrix({{0}, {0.75}, {3}}));
+  EXPECT_TRUE(S21Reduce::Min(m, S21Axis::kCols) ==
+              S21Matrix({{1, -7, -6, -1}}));
+  EXPECT_TRUE(S21Reduce::Max(m, S21Axis::kRows) ==
+              S21Matrix({{3}, {5}, {9}}));
+  EXPECT_EQ(S21Reduce::ArgMax(m, S21Axis::kRows), std::vector<int>({2, 1, 2}));
+  EXPECT_EQ(S21Reduce::ArgMin(m, S21Axis::kCols),
+            std::vector<int>({0, 0, 1, 2}));
+  EXPECT_EQ(S21Reduce::ArgMax(m, S21Axis::kCols),
+            std::vector<int>({1, 1, 2, 0}));
+  EXPECT_TRUE(S21Reduce::Norm(m, S21Axis::kRows, 1) ==
+              S21Matrix({{14}, {15}, {14}}));
+  EXPECT_TRUE(S21Reduce::Norm(m, S21Axis::kCols) ==
+              S21Matrix({{std::sqrt(21.0), std::sqrt(78.0), std::sqrt(126.0),
+                          std::sqrt(10.0)}}));
+  EXPECT_TRUE(S21Reduce::Norm(m, S21Axis::kRows, INFINITY) ==
+              S21Matrix({{7}, {6}, {9}}));
+  EXPECT_TRUE(S21Reduce::Norm(m, S21Axis::kCols, 3) ==
+              S21Matrix({{std::cbrt(73.0), std::cbrt(476.0), std::cbrt(972.0),
+                          std::cbrt(28.0)}}));
+  EXPECT_TRUE(S21Reduce::Variance(m, S21Axis::kCols, 1) ==
+              S21Matrix({{7.0 / 3, 39, 57, 13.0 / 3}}));
+  EXPECT_THROW(S21Reduce::Norm(m, S21Axis::kRows, 0.5), std::invalid_argument);
+  EXPECT_THROW(S21Reduce::Variance(m, S21Axis::kRows, 4),
+               std::invalid_argument);
+}
+
+TEST(S21ReduceTest, LargeReductionsMatchLoops) {
+  // enough rows for several row chunks and columns beyond the lane groups
+  S21Matrix m = TestMatrix(301, 75, 61);
+  m(150, 40) = 100;
+  m(200, 40) = 100;
+  S21Matrix sum = S21Reduce::Sum(m, S21Axis::kCols);
+  S21Matrix var = S21Reduce::Variance(m, S21Axis::kRows);
+  std::vector<int> arg = S21Reduce::ArgMax(m, S21Axis::kCols);
+  for (int j = 0; j < 75; ++j) {
+    double s = 0;
+    for (int i = 0; i < 301; ++i) s += m(i, j);
+    EXPECT_NEAR(sum(0, j), s, 1e-9);
+  }
+  for (int i = 0; i < 301; i += 50) {
+    double s = 0, q = 0;
+    for (int j = 0; j < 75; ++j) s += m(i, j);
+    for (int j = 0; j < 75; ++j) q += (m(i, j) - s / 75) * (m(i, j) - s / 75);
+    EXPECT_NEAR(var(i, 0), q / 75, 1e-9);
+  }
+  EXPECT_EQ(arg[40], 150);  // the first of equal maxima
+}
+
+TEST(S21BroadcastTest, BroadcastAndMeanCenter) {
+  S21Matrix m = {{1, 2, 3}, {4, 5, 6}};
+  EXPECT_TRUE(S21Broadcast::Sub(m, S21Matrix({{1, 2, 3}})) ==
+              S21Matrix({{0, 0, 0}, {3, 3, 3}}));
+  EXPECT_TRUE(S21Broadcast::Add(m, S21Matrix({{10}, {20}})) ==
+              S21Matrix({{11, 12, 13}, {24, 25, 26}}));
+  EXPECT_TRUE(S21Broadcast::Mul(m, m) ==
+              S21Matrix({{1, 4, 9}, {16, 25, 36}}));
+  EXPECT_TRUE(S21Broadcast::Div(m, S21Matrix({{2}})) ==
+              S21Matrix({{0.5, 1, 1.5}, {2, 2.5, 3}}));
+  EXPECT_THROW(S21Broadcast::Add(m, S21Matrix(2, 2)), std::invalid_argument);
+  S21Broadcast::ApplyInPlace(m, S21Broadcast::Op::kMul, m);
+  EXPECT_TRUE(m == S21Matrix({{1, 4, 9}, {16, 25, 36}}));
+
+  S21Matrix x = TestMatrix(130, 37, 67);
+  S21Matrix expected = S21Broadcast::Sub(x, S21Reduce::Mean(x, S21Axis::kCols));
+  S21Matrix means = S21Broadcast::MeanCenter(x, S21Axis::kCols);
+  EXPECT_TRUE(means.EqMatrix(
+      S21Reduce::Mean(S21Broadcast::Add(x, means), S21Axis::kCols),
+      S21Tolerance{1e-12}));
+  EXPECT_TRUE(x.EqMatrix(expected, S21Tolerance{1e-12}));
+  S21Matrix col = S21Reduce::Sum(x, S21Axis::kCols);
+  for (int j = 0; j < 37; ++j) EXPECT_NEAR(col(0, j), 0, 1e-12);
+  S21Broadcast::MeanCenter(x, S21Axis::kRows);
+  S21Matrix row = S21Reduce::Mean(x, S21Axis::kRows);
+  for (int i = 0; i < 130; ++i) EXPECT_NEAR(row(i, 0), 0, 1e-12);
+}
+
+TEST(S21AccumulatorTest, ConcurrentWritersMatchSerialSum) {
+  // more writers than shards, so claims also fall through to busy shards
+  S21Accumulator acc(33, 19, 3);
+  const int kWriters = 8, kAdds = 40;
+  std::atomic<int> done{0};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kWriters; ++t) {
+    writers.emplace_back([&, t] {
+      for (int k = 0; k < kAdds; ++k) acc += TestMatrix(33, 19, t * kAdds + k);
+      done.fetch_add(1);
+    });
+  }
+  // collecting mid-stream sees whole matrices only and loses nothing
+  while (done.load() < kWriters / 2) std::this_thread::yield();
+  S21Matrix partial = acc.Collect();
+  EXPECT_EQ(partial.get_Row(), 33);
+  for (std::thread& w : writers) w.join();
+  S21Matrix sum = acc.Collect();
+  S21Matrix serial(33, 19);
+  for (int i = 0; i < kWriters * kAdds; ++i) serial += TestMatrix(33, 19, i);
+  EXPECT_TRUE(sum.EqMatrix(serial, S21Tolerance{1e-9}));
+  EXPECT_TRUE(acc.Collect().EqMatrix(sum, S21Tolerance{0}));
+}
+
+TEST(S21AccumulatorTest, ResetAndShapes) {
+  S21Accumulator acc(2, 2, 5);
+  EXPECT_EQ(acc.Shards(), 5);
+  EXPECT_TRUE(acc.Collect() == S21Matrix(2, 2));
+  acc.Add(S21Matrix({{1, 2}, {3, 4}}));
+  acc += S21Matrix({{1, 1}, {1, 1}});
+  EXPECT_TRUE(acc.Collect() == S21Matrix({{2, 3}, {4, 5}}));
+  EXPECT_THROW(acc.Add(S21Matrix(2, 3)), std::invalid_argument);
+  acc.Reset();
+  EXPECT_TRUE(acc.Collect() == S21Matrix(2, 2));
+  EXPECT_THROW(S21Accumulator(0, 2), std::invalid_argument);
+  EXPECT_GE(S21Accumulator(1, 1).Shards(), 1);
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();